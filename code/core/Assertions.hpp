@@ -1,3 +1,37 @@
 #pragma once
 
-#define ally_assert(...)
\ No newline at end of file
+//
+// INFO: 'ally_assume' tells optimizer that condition is always true,
+// if condition is false behaviour is undefined, use it only in hot loops
+// where invariant is proven. Condition must be free of side effects, with
+// '__builtin_unreachable' fallback it is still evaluated
+//
+#if defined(__clang__)
+#define ally_assume(condition) __builtin_assume(condition)
+#elif defined(_MSC_VER)
+#define ally_assume(condition) __assume(condition)
+#elif defined(__has_cpp_attribute) && __cplusplus > 202002L
+#if __has_cpp_attribute(assume)
+#define ally_assume(condition) [[assume(condition)]]
+#endif
+#endif
+
+#if !defined(ally_assume)
+#if defined(__GNUC__)
+#define ally_assume(condition) ((condition) ? static_cast<void>(0) : __builtin_unreachable())
+#else
+#define ally_assume(condition) static_cast<void>(0)
+#endif
+#endif
+
+//
+// INFO: Define ALLY_ASSERT_ASSUME in release builds to turn 'ally_assert'
+// into 'ally_assume', so stated invariants are not lost to optimizer.
+// Don't use 'ally_assert(false, ...)' as a reminder in reachable code then
+//
+#if defined(ALLY_ASSERT_ASSUME)
+#define ally_assert_condition(condition, ...) ally_assume(condition)
+#define ally_assert(...) ally_assert_condition(__VA_ARGS__, 0)
+#else
+#define ally_assert(...)
+#endif
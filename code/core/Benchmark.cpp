@@ -0,0 +1,388 @@
+#include "Benchmark.hpp"
+#include "ConstexprRandom.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double medianOf(std::vector<double>& values)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    const double upper = values[middle];
+    if (values.size() % 2 == 1) {
+        return upper;
+    }
+
+    const double lower = *std::max_element(values.begin(), values.begin() + middle);
+    return 0.5 * (lower + upper);
+}
+
+class Resampler {
+public:
+    explicit Resampler(uint64_t seed)
+        : m_generator(seed)
+    {
+    }
+
+    double median(const std::vector<double>& samples, std::vector<double>& scratch)
+    {
+        const auto count = static_cast<uint64_t>(samples.size());
+        scratch.resize(samples.size());
+        for (double& value : scratch) {
+            value = samples[(static_cast<uint64_t>(m_generator()) * count) >> 32u];
+        }
+        return medianOf(scratch);
+    }
+
+private:
+    Pcg32 m_generator;
+};
+
+//
+// INFO: Pins calling thread for one comparison, previous affinity mask is
+// restored on destruction
+//
+class ScopedPin {
+public:
+    explicit ScopedPin(int cpu)
+    {
+#if defined(__linux__)
+        m_pinned = cpu >= 0 && pthread_getaffinity_np(pthread_self(), sizeof(m_previous), &m_previous) == 0 && pinCurrentThread(cpu);
+#else
+        (void)cpu;
+#endif
+    }
+
+    ~ScopedPin()
+    {
+#if defined(__linux__)
+        if (m_pinned) {
+            pthread_setaffinity_np(pthread_self(), sizeof(m_previous), &m_previous);
+        }
+#endif
+    }
+
+    ScopedPin(const ScopedPin&) = delete;
+    ScopedPin& operator=(const ScopedPin&) = delete;
+
+private:
+#if defined(__linux__)
+    cpu_set_t m_previous;
+    bool m_pinned = false;
+#endif
+};
+
+//
+// INFO: Percentile interval, 'values' are reordered
+//
+std::pair<double, double> interval(std::vector<double>& values, double confidence)
+{
+    if (values.empty()) {
+        return { 0.0, 0.0 };
+    }
+
+    std::sort(values.begin(), values.end());
+    const double tail = 0.5 * (1.0 - confidence) * static_cast<double>(values.size() - 1);
+    const auto low = static_cast<size_t>(std::floor(tail));
+    const auto high = static_cast<size_t>(std::ceil(static_cast<double>(values.size() - 1) - tail));
+    return { values[low], values[high] };
+}
+
+//
+// INFO: Failed samples are dropped and counted, 'isValid' rejects comparison with any
+//
+BenchmarkSummary summarize(std::vector<double> samples, const BenchmarkOptions& options, Resampler& resampler)
+{
+    BenchmarkSummary summary;
+    const auto failed = std::remove_if(samples.begin(), samples.end(), [](double sample) { return !(sample >= 0.0) || !std::isfinite(sample); });
+    summary.failures = static_cast<size_t>(samples.end() - failed);
+    samples.erase(failed, samples.end());
+
+    summary.samples = std::move(samples);
+    if (summary.samples.empty()) {
+        return summary;
+    }
+
+    std::vector<double> scratch = summary.samples;
+    summary.median = medianOf(scratch);
+
+    std::vector<double> medians(options.resamples);
+    for (double& median : medians) {
+        median = resampler.median(summary.samples, scratch);
+    }
+
+    const auto bounds = interval(medians, options.confidence);
+    summary.low = bounds.first;
+    summary.high = bounds.second;
+    return summary;
+}
+
+void writeCounters(std::ostream& out, const char* side, const BenchmarkCounters& counters)
+{
+    out << ", " << side << " cycles " << counters.perCall(&PerfSample::cycles)
+        << " instructions " << counters.perCall(&PerfSample::instructions)
+        << " IPC " << counters.total.instructionsPerCycle()
+        << " cache misses " << counters.perCall(&PerfSample::cacheMisses)
+        << " branch misses " << counters.perCall(&PerfSample::branchMisses);
+}
+}
+
+double BenchmarkCounters::perCall(uint64_t PerfSample::*counter) const
+{
+    return calls == 0 ? 0.0 : static_cast<double>(total.*counter) / static_cast<double>(calls);
+}
+
+BenchmarkSampler loopSampler(std::function<void()> body, double sampleSeconds, BenchmarkCounters* counters)
+{
+    auto iterations = std::make_shared<size_t>(0);
+
+    return [body = std::move(body), sampleSeconds, iterations, counters]() {
+        //
+        // INFO: First call doubles iteration count until the loop is long
+        // enough, the count is then fixed so all samples do the same work
+        //
+        if (*iterations == 0) {
+            size_t count = 1;
+            for (;;) {
+                const auto start = Clock::now();
+                for (size_t i = 0; i < count; ++i) {
+                    body();
+                }
+                if (secondsSince(start) >= sampleSeconds || count >= (size_t(1) << 40u)) {
+                    break;
+                }
+                count *= 2;
+            }
+            *iterations = count;
+        }
+
+        const size_t count = *iterations;
+        std::optional<PerfScope> scope;
+        if (counters) {
+            counters->calls += count;
+            scope.emplace(counters->total);
+        }
+
+        const auto start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            body();
+        }
+        return secondsSince(start) / static_cast<double>(count);
+    };
+}
+
+BenchmarkSampler commandSampler(std::vector<std::string> arguments)
+{
+    return [arguments = std::move(arguments)]() {
+#if defined(__unix__) || defined(__APPLE__)
+        std::vector<char*> argv;
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const auto start = Clock::now();
+        pid_t child = 0;
+        if (argv.size() < 2 || posix_spawnp(&child, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+            return -1.0;
+        }
+
+        int status = 0;
+        if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            return -1.0;
+        }
+        return secondsSince(start);
+#else
+        return -1.0;
+#endif
+    };
+}
+
+BenchmarkComparison compareBenchmarks(const BenchmarkSampler& a, const BenchmarkSampler& b, const BenchmarkOptions& options)
+{
+    const ScopedPin pin(options.cpu);
+
+    for (size_t round = 0; round < options.warmupRounds; ++round) {
+        a();
+        b();
+    }
+
+    std::vector<double> samplesA;
+    std::vector<double> samplesB;
+    for (size_t round = 0; round < options.rounds; ++round) {
+        if (round % 2 == 0) {
+            samplesA.push_back(a());
+            samplesB.push_back(b());
+        } else {
+            samplesB.push_back(b());
+            samplesA.push_back(a());
+        }
+    }
+
+    return compareSamples(std::move(samplesA), std::move(samplesB), options);
+}
+
+BenchmarkComparison compareSamples(std::vector<double> a, std::vector<double> b, const BenchmarkOptions& options)
+{
+    BenchmarkComparison comparison;
+    Resampler resampler(options.seed);
+
+    comparison.a = summarize(std::move(a), options, resampler);
+    comparison.b = summarize(std::move(b), options, resampler);
+
+    const auto& samplesA = comparison.a.samples;
+    const auto& samplesB = comparison.b.samples;
+    comparison.pValue = mannWhitneyPValue(samplesA, samplesB);
+    if (samplesA.empty() || samplesB.empty() || comparison.a.median <= 0.0) {
+        return comparison;
+    }
+
+    comparison.ratio = comparison.b.median / comparison.a.median;
+
+    std::vector<double> scratch;
+    std::vector<double> ratios(options.resamples);
+    for (double& ratio : ratios) {
+        const double medianA = resampler.median(samplesA, scratch);
+        const double medianB = resampler.median(samplesB, scratch);
+        ratio = medianA > 0.0 ? medianB / medianA : 1.0;
+    }
+
+    const auto bounds = interval(ratios, options.confidence);
+    comparison.ratioLow = bounds.first;
+    comparison.ratioHigh = bounds.second;
+
+    comparison.isValid = comparison.a.failures == 0 && comparison.b.failures == 0;
+    if (!comparison.isValid) {
+        return comparison;
+    }
+
+    comparison.isSignificant = comparison.pValue < options.significance;
+    comparison.isRegression = comparison.isSignificant
+        && comparison.ratio > 1.0 + options.regressionThreshold
+        && comparison.ratioLow > 1.0;
+    comparison.isImprovement = comparison.isSignificant
+        && comparison.ratio < 1.0 - options.regressionThreshold
+        && comparison.ratioHigh < 1.0;
+    return comparison;
+}
+
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b)
+{
+    const size_t countA = a.size();
+    const size_t countB = b.size();
+    const size_t count = countA + countB;
+    if (countA == 0 || countB == 0) {
+        return 1.0;
+    }
+
+    std::vector<std::pair<double, bool>> values;
+    values.reserve(count);
+    for (double value : a) {
+        values.emplace_back(value, true);
+    }
+    for (double value : b) {
+        values.emplace_back(value, false);
+    }
+    std::sort(values.begin(), values.end());
+
+    //
+    // INFO: Tied values get average rank, ties shrink variance of U
+    //
+    double rankSumA = 0.0;
+    double tieCorrection = 0.0;
+    for (size_t first = 0; first < count;) {
+        size_t last = first + 1;
+        while (last < count && values[last].first == values[first].first) {
+            ++last;
+        }
+
+        const double rank = 0.5 * static_cast<double>(first + last + 1);
+        for (size_t i = first; i < last; ++i) {
+            rankSumA += values[i].second ? rank : 0.0;
+        }
+
+        const auto ties = static_cast<double>(last - first);
+        tieCorrection += ties * ties * ties - ties;
+        first = last;
+    }
+
+    const auto n = static_cast<double>(count);
+    const auto nA = static_cast<double>(countA);
+    const auto nB = static_cast<double>(countB);
+
+    const double u = rankSumA - nA * (nA + 1.0) / 2.0;
+    const double mean = nA * nB / 2.0;
+    const double variance = nA * nB / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+    if (variance <= 0.0) {
+        return 1.0;
+    }
+
+    const double z = std::max(0.0, std::abs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+void writeComparison(std::ostream& out, std::string_view name, const BenchmarkComparison& comparison,
+    const BenchmarkCounters* countersA, const BenchmarkCounters* countersB)
+{
+    const char* verdict = !comparison.isValid ? "INVALID"
+        : comparison.isRegression             ? "REGRESSION"
+        : comparison.isImprovement            ? "improvement"
+        : comparison.isSignificant            ? "within threshold"
+                                              : "no difference";
+
+    out << name << ": A " << comparison.a.median << " [" << comparison.a.low << ", " << comparison.a.high << "]"
+        << ", B " << comparison.b.median << " [" << comparison.b.low << ", " << comparison.b.high << "]"
+        << ", B/A " << comparison.ratio << " [" << comparison.ratioLow << ", " << comparison.ratioHigh << "]"
+        << ", p " << comparison.pValue << ", " << verdict;
+
+    if (comparison.a.failures != 0 || comparison.b.failures != 0) {
+        out << ", failed samples A " << comparison.a.failures << " B " << comparison.b.failures;
+    }
+
+    if (countersA && countersB && countersA->total.cycles != 0 && countersB->total.cycles != 0) {
+        writeCounters(out, "A", *countersA);
+        writeCounters(out, "B", *countersB);
+    }
+    out << '\n';
+}
+
+bool pinCurrentThread(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
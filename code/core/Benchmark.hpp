@@ -0,0 +1,123 @@
+#pragma once
+
+#include "PerfCounters.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//
+// INFO: A/B comparison of two implementations or two builds. Single timings
+// are too noisy to act on, harness pins thread to core, warms up, then
+// interleaves samples of A and B in 'ABBA' order, so frequency scaling and
+// background load drift hit both sides equally.
+//
+// Result has medians with bootstrap confidence intervals, ratio 'B / A' of
+// medians with its own interval and two-sided Mann-Whitney U test. Change is
+// flagged as regression only when it is significant and ratio is above
+// '1 + regressionThreshold', lower bound of ratio interval must agree too.
+// Negative or non-finite sample is a failure, comparison with any failure
+// is invalid and flags nothing
+//
+// Usage:
+//   BenchmarkCounters countersA, countersB;
+//   auto result = compareBenchmarks(
+//       loopSampler([&] { doNotOptimize(RandomBase<...>::uniformFrom(items)); }, 0.01, &countersA),
+//       loopSampler([&] { doNotOptimize(candidate.uniformFrom(items)); }, 0.01, &countersB));
+//   writeComparison(std::cout, "uniformFrom", result, &countersA, &countersB);
+//
+// Two builds: 'compareBenchmarks(commandSampler({ "./old/bench" }), commandSampler({ "./new/bench" }))'
+//
+struct BenchmarkOptions {
+    int cpu = 0; // negative - don't pin, previous affinity is restored after comparison
+    size_t warmupRounds = 3;
+    size_t rounds = 31;
+    size_t resamples = 2000;
+    double confidence = 0.95;
+    double significance = 0.05;
+    double regressionThreshold = 0.02;
+    uint64_t seed = 0x510e527fade682d1ull;
+};
+
+struct BenchmarkSummary {
+    std::vector<double> samples;
+    size_t failures = 0;
+    double median = 0.0;
+    double low = 0.0;
+    double high = 0.0;
+};
+
+struct BenchmarkComparison {
+    BenchmarkSummary a;
+    BenchmarkSummary b;
+
+    double ratio = 1.0;
+    double ratioLow = 1.0;
+    double ratioHigh = 1.0;
+
+    double pValue = 1.0;
+    bool isValid = false;
+    bool isSignificant = false;
+    bool isRegression = false;
+    bool isImprovement = false;
+};
+
+//
+// INFO: Sampler returns one measurement, lower is better, e.g. seconds per operation
+//
+using BenchmarkSampler = std::function<double()>;
+
+//
+// INFO: Hardware counters of measured loops, calibration isn't counted.
+// Stays zero when 'PerfCounters' are unavailable
+//
+struct BenchmarkCounters {
+    PerfSample total;
+    uint64_t calls = 0;
+
+    double perCall(uint64_t PerfSample::*counter) const;
+};
+
+//
+// INFO: Calls 'body' in a loop, iteration count is calibrated once so one
+// sample lasts at least 'sampleSeconds', returns seconds per call. Counters
+// of calling thread are added to 'counters' when it isn't null, it must
+// outlive sampler
+//
+BenchmarkSampler loopSampler(std::function<void()> body, double sampleSeconds = 0.01, BenchmarkCounters* counters = nullptr);
+
+//
+// INFO: Spawns process and returns its wall time in seconds,
+// negative when process can't be started or exits with error
+//
+BenchmarkSampler commandSampler(std::vector<std::string> arguments);
+
+BenchmarkComparison compareBenchmarks(const BenchmarkSampler& a, const BenchmarkSampler& b, const BenchmarkOptions& options = BenchmarkOptions());
+BenchmarkComparison compareSamples(std::vector<double> a, std::vector<double> b, const BenchmarkOptions& options = BenchmarkOptions());
+
+//
+// INFO: Two-sided p-value by normal approximation with tie correction
+//
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b);
+
+//
+// INFO: Counters of A and B are written per call when both are given and available
+//
+void writeComparison(std::ostream& out, std::string_view name, const BenchmarkComparison& comparison,
+    const BenchmarkCounters* countersA = nullptr, const BenchmarkCounters* countersB = nullptr);
+
+bool pinCurrentThread(int cpu);
+
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
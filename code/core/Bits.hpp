@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//
+// INFO: Results are undefined for zero input, same as compiler builtins
+//
+inline int countTrailingZeros(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+inline int countTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+inline int countLeadingZeros(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse(&index, value);
+    return 31 - static_cast<int>(index);
+#else
+    return __builtin_clz(value);
+#endif
+}
+
+inline int countLeadingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+inline uint64_t roundUpToPowerOfTwo(uint64_t value)
+{
+    return value <= 1 ? 1 : uint64_t(1) << (64 - countLeadingZeros(value - 1));
+}
@@ -0,0 +1,441 @@
+#pragma once
+
+#include "Bits.hpp"
+#include "EpochReclamation.hpp"
+#include "Random.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//
+// INFO: Thread local cache of skip list nodes by height, nodes reclaimed by
+// 'EpochReclamation' go here first, so steady insert/erase traffic doesn't
+// hit 'malloc'. Cache is per node layout, shared by lists of the same type
+//
+template <typename Node, int MaxHeight>
+class SkipListNodePool {
+public:
+    static void* acquire(int height)
+    {
+        auto& free = cache().free[height - 1];
+        if (!free.empty()) {
+            void* memory = free.back();
+            free.pop_back();
+            return memory;
+        }
+        return ::operator new(Node::bytesFor(height));
+    }
+
+    static void release(void* memory, int height)
+    {
+        auto& free = cache().free[height - 1];
+        if (free.size() < MaxCachedPerHeight) {
+            free.push_back(memory);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+private:
+    static constexpr size_t MaxCachedPerHeight = 1024;
+
+    struct Cache {
+        std::vector<void*> free[MaxHeight];
+
+        ~Cache()
+        {
+            for (auto& list : free) {
+                for (void* memory : list) {
+                    ::operator delete(memory);
+                }
+            }
+        }
+    };
+
+    static Cache& cache()
+    {
+        thread_local Cache s_cache;
+        return s_cache;
+    }
+};
+
+//
+// INFO: Lock-free ordered map (Herlihy-Shavit skip list with marked links).
+// Node is logically removed when its level 0 link is marked, memory is
+// reclaimed through 'EpochReclamation' once both its insert and its erase
+// have finished unlinking. Values are immutable after insert, 'find' and
+// scans return copies or call 'fn' under epoch guard
+//
+// Usage:
+//   ConcurrentSkipList<int64_t, PlayerId, std::greater<>> leaderboard;
+//   leaderboard.insert(score, player);
+//   leaderboard.forEachFrom(topScore, 10, [](int64_t score, PlayerId player) { ... });
+//
+template <typename Key, typename Value, typename Compare = std::less<>>
+class ConcurrentSkipList {
+public:
+    static constexpr int MaxHeight = 32;
+
+    ConcurrentSkipList()
+    {
+        for (auto& link : m_head) {
+            link.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    //
+    // INFO: Destructor expects that no other thread uses the list
+    //
+    ~ConcurrentSkipList()
+    {
+        Node* node = pointer(m_head[0].load(std::memory_order_acquire));
+        while (node) {
+            Node* next = pointer(node->links()[0].load(std::memory_order_relaxed));
+            if (!isMarked(node->links()[0].load(std::memory_order_relaxed))) {
+                node->~Node();
+                ::operator delete(node);
+            }
+            node = next;
+        }
+    }
+
+    ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+    ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+    bool insert(const Key& key, const Value& value)
+    {
+        EpochReclamation::Guard guard;
+
+        Link* preds[MaxHeight];
+        Node* succs[MaxHeight];
+
+        const int height = randomHeight();
+        Node* node = nullptr;
+
+        while (true) {
+            if (find(key, preds, succs)) {
+                if (node) {
+                    node->~Node();
+                    Pool::release(node, height);
+                }
+                return false;
+            }
+
+            if (!node) {
+                node = new (Pool::acquire(height)) Node(key, value, height);
+            }
+
+            for (int level = 0; level < height; ++level) {
+                node->links()[level].store(address(succs[level]), std::memory_order_relaxed);
+            }
+
+            uintptr_t expected = address(succs[0]);
+            if (preds[0][0].compare_exchange_strong(expected, address(node), std::memory_order_acq_rel)) {
+                break;
+            }
+        }
+
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        linkUpperLevels(node, preds, succs);
+        release(node);
+        return true;
+    }
+
+    bool erase(const Key& key)
+    {
+        EpochReclamation::Guard guard;
+
+        Link* preds[MaxHeight];
+        Node* succs[MaxHeight];
+        if (!find(key, preds, succs)) {
+            return false;
+        }
+        return remove(succs[0]);
+    }
+
+    //
+    // INFO: Removes and returns smallest element, handy for time-ordered queues
+    //
+    std::optional<std::pair<Key, Value>> popFront()
+    {
+        EpochReclamation::Guard guard;
+
+        while (true) {
+            Node* node = pointer(m_head[0].load(std::memory_order_acquire));
+            while (node && isMarked(node->links()[0].load(std::memory_order_acquire))) {
+                node = pointer(node->links()[0].load(std::memory_order_acquire));
+            }
+
+            if (!node) {
+                return std::nullopt;
+            }
+
+            std::pair<Key, Value> item(node->key, node->value);
+            if (remove(node)) {
+                return item;
+            }
+        }
+    }
+
+    bool contains(const Key& key) const
+    {
+        EpochReclamation::Guard guard;
+        return findNode(key) != nullptr;
+    }
+
+    std::optional<Value> find(const Key& key) const
+    {
+        EpochReclamation::Guard guard;
+        if (const Node* node = findNode(key)) {
+            return node->value;
+        }
+        return std::nullopt;
+    }
+
+    //
+    // INFO: Calls 'fn(key, value)' for keys in [from, to), scan is not a snapshot,
+    // concurrent inserts and erases may be seen or not
+    //
+    template <typename F>
+    void forEachInRange(const Key& from, const Key& to, F&& fn) const
+    {
+        EpochReclamation::Guard guard;
+
+        for (const Node* node = lowerBound(from); node && m_compare(node->key, to); node = next(node)) {
+            fn(node->key, node->value);
+        }
+    }
+
+    template <typename F>
+    void forEachFrom(const Key& from, size_t count, F&& fn) const
+    {
+        EpochReclamation::Guard guard;
+
+        for (const Node* node = lowerBound(from); node && count > 0; node = next(node), --count) {
+            fn(node->key, node->value);
+        }
+    }
+
+    //
+    // INFO: Approximate while other threads modify the list
+    //
+    size_t size() const
+    {
+        const auto size = m_size.load(std::memory_order_relaxed);
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+
+private:
+    using Link = std::atomic<uintptr_t>;
+
+    struct alignas(Link) Node {
+        Key key;
+        Value value;
+        int height;
+
+        //
+        // INFO: Both insert and erase must finish unlinking before node is retired
+        //
+        std::atomic<int> owners { 2 };
+
+        Node(const Key& nodeKey, const Value& nodeValue, int nodeHeight)
+            : key(nodeKey)
+            , value(nodeValue)
+            , height(nodeHeight)
+        {
+            for (int level = 0; level < height; ++level) {
+                new (links() + level) Link(0);
+            }
+        }
+
+        Link* links() { return reinterpret_cast<Link*>(this + 1); }
+        const Link* links() const { return reinterpret_cast<const Link*>(this + 1); }
+
+        static size_t bytesFor(int height) { return sizeof(Node) + static_cast<size_t>(height) * sizeof(Link); }
+    };
+
+    using Pool = SkipListNodePool<Node, MaxHeight>;
+
+    static bool isMarked(uintptr_t link) { return (link & 1u) != 0; }
+    static Node* pointer(uintptr_t link) { return reinterpret_cast<Node*>(link & ~uintptr_t(1)); }
+    static uintptr_t address(const Node* node) { return reinterpret_cast<uintptr_t>(node); }
+
+    //
+    // INFO: Tower height from one draw: trailing zero bits of uniform
+    // value are geometric with p = 1/2
+    //
+    static int randomHeight()
+    {
+        const uint32_t bits = ThreadRandom::uniform<uint32_t>() | (uint32_t(1) << (MaxHeight - 1));
+        return 1 + countTrailingZeros(bits);
+    }
+
+    static void reclaim(void* object)
+    {
+        auto* node = static_cast<Node*>(object);
+        const int height = node->height;
+        node->~Node();
+        Pool::release(node, height);
+    }
+
+    static void release(Node* node)
+    {
+        if (node->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            epochReclamation().retire(node, &ConcurrentSkipList::reclaim);
+        }
+    }
+
+    //
+    // INFO: Fills predecessor links and successors on every level and snips
+    // marked nodes on the way, after it no marked node with 'key' is reachable
+    //
+    bool find(const Key& key, Link** preds, Node** succs) const
+    {
+    retry:
+        Link* pred = m_head;
+        Node* curr = nullptr;
+
+        for (int level = MaxHeight - 1; level >= 0; --level) {
+            curr = pointer(pred[level].load(std::memory_order_acquire));
+
+            while (curr) {
+                uintptr_t succ = curr->links()[level].load(std::memory_order_acquire);
+
+                while (isMarked(succ)) {
+                    uintptr_t expected = address(curr);
+                    if (!pred[level].compare_exchange_strong(expected, succ & ~uintptr_t(1), std::memory_order_acq_rel)) {
+                        goto retry;
+                    }
+
+                    curr = pointer(succ);
+                    if (!curr) {
+                        break;
+                    }
+                    succ = curr->links()[level].load(std::memory_order_acquire);
+                }
+
+                if (!curr || !m_compare(curr->key, key)) {
+                    break;
+                }
+
+                pred = curr->links();
+                curr = pointer(succ);
+            }
+
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+
+        return curr && !m_compare(key, curr->key);
+    }
+
+    void linkUpperLevels(Node* node, Link** preds, Node** succs)
+    {
+        for (int level = 1; level < node->height; ++level) {
+            while (true) {
+                uintptr_t link = node->links()[level].load(std::memory_order_acquire);
+                if (isMarked(link)) {
+                    goto done;
+                }
+
+                if (link != address(succs[level])
+                    && !node->links()[level].compare_exchange_strong(link, address(succs[level]), std::memory_order_acq_rel)) {
+                    goto done;
+                }
+
+                uintptr_t expected = address(succs[level]);
+                if (preds[level][level].compare_exchange_strong(expected, address(node), std::memory_order_acq_rel)) {
+                    break;
+                }
+
+                if (!find(node->key, preds, succs) || succs[0] != node) {
+                    goto done;
+                }
+            }
+        }
+
+    done:
+        //
+        // INFO: Erase could run between our links, snip node again,
+        // after this insert never links it anywhere
+        //
+        if (isMarked(node->links()[0].load(std::memory_order_acquire))) {
+            find(node->key, preds, succs);
+        }
+    }
+
+    bool remove(Node* node)
+    {
+        for (int level = node->height - 1; level >= 1; --level) {
+            uintptr_t link = node->links()[level].load(std::memory_order_acquire);
+            while (!isMarked(link)) {
+                node->links()[level].compare_exchange_weak(link, link | 1u, std::memory_order_acq_rel);
+            }
+        }
+
+        uintptr_t link = node->links()[0].load(std::memory_order_acquire);
+        while (true) {
+            if (isMarked(link)) {
+                return false;
+            }
+            if (node->links()[0].compare_exchange_weak(link, link | 1u, std::memory_order_acq_rel)) {
+                break;
+            }
+        }
+
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+
+        Link* preds[MaxHeight];
+        Node* succs[MaxHeight];
+        find(node->key, preds, succs);
+        release(node);
+        return true;
+    }
+
+    //
+    // INFO: Read only search, doesn't snip marked nodes
+    //
+    const Node* lowerBound(const Key& key) const
+    {
+        const Link* pred = m_head;
+        const Node* curr = nullptr;
+
+        for (int level = MaxHeight - 1; level >= 0; --level) {
+            curr = pointer(pred[level].load(std::memory_order_acquire));
+            while (curr && m_compare(curr->key, key)) {
+                pred = curr->links();
+                curr = pointer(pred[level].load(std::memory_order_acquire));
+            }
+        }
+
+        while (curr && isMarked(curr->links()[0].load(std::memory_order_acquire))) {
+            curr = pointer(curr->links()[0].load(std::memory_order_acquire));
+        }
+        return curr;
+    }
+
+    const Node* findNode(const Key& key) const
+    {
+        const Node* node = lowerBound(key);
+        return node && !m_compare(key, node->key) ? node : nullptr;
+    }
+
+    static const Node* next(const Node* node)
+    {
+        const Node* curr = pointer(node->links()[0].load(std::memory_order_acquire));
+        while (curr && isMarked(curr->links()[0].load(std::memory_order_acquire))) {
+            curr = pointer(curr->links()[0].load(std::memory_order_acquire));
+        }
+        return curr;
+    }
+
+private:
+    mutable Link m_head[MaxHeight];
+    std::atomic<int64_t> m_size { 0 };
+    Compare m_compare;
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+//
+// INFO: Generators and distributions below are fully constexpr, so they can build
+// permutation tables, hash salts and fixtures at compile time. Unlike 'std::' distributions
+// used by 'RandomBase' the algorithms are fixed, so for the same seed a table baked
+// into read-only data is identical to the one produced by the same call at run time
+//
+
+class SplitMix64
+{
+public:
+    using result_type = uint64_t;
+
+    constexpr explicit SplitMix64(uint64_t seed = 0)
+        : m_state(seed)
+    {
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    constexpr result_type operator()()
+    {
+        m_state += 0x9e3779b97f4a7c15ull;
+        return mix(m_state);
+    }
+
+    static constexpr uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t m_state;
+};
+
+//
+// https://www.pcg-random.org/ 'pcg32' (XSH RR 64/32)
+//
+class Pcg32
+{
+public:
+    using result_type = uint32_t;
+
+    constexpr Pcg32()
+        : Pcg32(0x853c49e6748fea9bull, 0xda3e39cb94b95bdbull)
+    {
+    }
+
+    constexpr explicit Pcg32(uint64_t seedValue, uint64_t stream = 0xda3e39cb94b95bdbull)
+    {
+        seed(seedValue, stream);
+    }
+
+    constexpr void seed(uint64_t seedValue, uint64_t stream = 0xda3e39cb94b95bdbull)
+    {
+        m_state = 0;
+        m_increment = (stream << 1u) | 1u;
+        step();
+        m_state += seedValue;
+        step();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    constexpr result_type operator()()
+    {
+        const uint64_t old = m_state;
+        step();
+        const auto xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        const auto rotation = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+    }
+
+    constexpr void discard(unsigned long long count)
+    {
+        for (; count > 0; --count) {
+            step();
+        }
+    }
+
+    constexpr bool operator==(const Pcg32& other) const
+    {
+        return m_state == other.m_state && m_increment == other.m_increment;
+    }
+
+    constexpr bool operator!=(const Pcg32& other) const { return !(*this == other); }
+
+private:
+    constexpr void step() { m_state = m_state * 6364136223846793005ull + m_increment; }
+
+private:
+    uint64_t m_state = 0;
+    uint64_t m_increment = 0;
+};
+
+class ConstexprRandom
+{
+public:
+    template <typename T, typename G>
+    static constexpr T uniform(G& generator);
+    template <typename T, typename G>
+    static constexpr T uniform(T to, G& generator);
+    template <typename T, typename G>
+    static constexpr T uniform(T from, T to, G& generator);
+
+    template <typename T, typename G>
+    static constexpr T uniformf(G& generator);
+    template <typename T, typename G>
+    static constexpr T uniformf(T to, G& generator);
+    template <typename T, typename G>
+    static constexpr T uniformf(T from, T to, G& generator);
+
+    template <typename G>
+    static constexpr bool yesNo(G& generator);
+
+    template <class RandomAccessIterator, typename G>
+    static constexpr void shuffle(RandomAccessIterator first, RandomAccessIterator last, G& generator);
+
+    template <typename T, size_t N, typename G = Pcg32>
+    static constexpr std::array<T, N> permutation(uint64_t seed);
+
+private:
+    template <typename G>
+    static constexpr uint32_t bits32(G& generator);
+    template <typename G>
+    static constexpr uint64_t bits64(G& generator);
+};
+
+// implementation
+
+template <typename G>
+constexpr uint32_t ConstexprRandom::bits32(G& generator)
+{
+    static_assert(G::min() == 0, "Generator range must start at zero.");
+    static_assert(G::max() == std::numeric_limits<uint32_t>::max() || G::max() == std::numeric_limits<uint64_t>::max(),
+        "Generator must produce 32 or 64 random bits.");
+
+    if (G::max() == std::numeric_limits<uint32_t>::max()) {
+        return static_cast<uint32_t>(generator());
+    } else {
+        return static_cast<uint32_t>(static_cast<uint64_t>(generator()) >> 32u);
+    }
+}
+
+template <typename G>
+constexpr uint64_t ConstexprRandom::bits64(G& generator)
+{
+    if (G::max() == std::numeric_limits<uint32_t>::max()) {
+        const uint64_t high = bits32(generator);
+        const uint64_t low = bits32(generator);
+        return (high << 32u) | low;
+    } else {
+        return static_cast<uint64_t>(generator());
+    }
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniform(G& generator)
+{
+    static_assert(std::is_integral<T>::value, "Integral required.");
+    return uniform<T>(static_cast<T>(0), std::numeric_limits<T>::max(), generator);
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniform(T to, G& generator)
+{
+    static_assert(std::is_integral<T>::value, "Integral required.");
+    return uniform<T>(static_cast<T>(0), to, generator);
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniform(T from, T to, G& generator)
+{
+    static_assert(std::is_integral<T>::value, "Integral required.");
+
+    using Unsigned = std::conditional_t<(sizeof(T) <= sizeof(uint32_t)), uint32_t, uint64_t>;
+
+    const auto range = static_cast<Unsigned>(static_cast<Unsigned>(to) - static_cast<Unsigned>(from));
+    const auto draw = [&generator]() -> Unsigned {
+        if (sizeof(Unsigned) == sizeof(uint32_t)) {
+            return static_cast<Unsigned>(bits32(generator));
+        } else {
+            return static_cast<Unsigned>(bits64(generator));
+        }
+    };
+
+    if (range == std::numeric_limits<Unsigned>::max()) {
+        return static_cast<T>(static_cast<Unsigned>(from) + draw());
+    }
+
+    //
+    // INFO: Plain rejection instead of Lemire's multiply, because 128 bit
+    // multiplication is not portable in constexpr context
+    //
+    const Unsigned bound = range + 1;
+    const Unsigned threshold = static_cast<Unsigned>(0u - bound) % bound;
+
+    Unsigned value = draw();
+    while (value < threshold) {
+        value = draw();
+    }
+
+    return static_cast<T>(static_cast<Unsigned>(from) + value % bound);
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniformf(G& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+
+    //
+    // INFO: Range is [0, 1), all mantissa bits are random
+    //
+    if (std::numeric_limits<T>::digits <= 24) {
+        return static_cast<T>(static_cast<float>(bits32(generator) >> 8u) * 0x1.0p-24f);
+    } else {
+        return static_cast<T>(static_cast<double>(bits64(generator) >> 11u) * 0x1.0p-53);
+    }
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniformf(T to, G& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    return uniformf<T>(generator) * to;
+}
+
+template <typename T, typename G>
+constexpr T ConstexprRandom::uniformf(T from, T to, G& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    return from + uniformf<T>(generator) * (to - from);
+}
+
+template <typename G>
+constexpr bool ConstexprRandom::yesNo(G& generator)
+{
+    return (bits32(generator) >> 31u) != 0;
+}
+
+template <class RandomAccessIterator, typename G>
+constexpr void ConstexprRandom::shuffle(RandomAccessIterator first, RandomAccessIterator last, G& generator)
+{
+    //
+    // Fisher-Yates, 'std::swap' and 'std::shuffle' are not constexpr before C++20
+    //
+    using OffsetType = typename std::iterator_traits<RandomAccessIterator>::difference_type;
+
+    for (OffsetType i = last - first - 1; i > 0; --i) {
+        const auto j = uniform<OffsetType>(static_cast<OffsetType>(0), i, generator);
+        auto tmp = std::move(first[i]);
+        first[i] = std::move(first[j]);
+        first[j] = std::move(tmp);
+    }
+}
+
+template <typename T, size_t N, typename G>
+constexpr std::array<T, N> ConstexprRandom::permutation(uint64_t seed)
+{
+    std::array<T, N> table {};
+    for (size_t i = 0; i < N; ++i) {
+        table[i] = static_cast<T>(i);
+    }
+
+    G generator(seed);
+    shuffle(table.begin(), table.end(), generator);
+    return table;
+}
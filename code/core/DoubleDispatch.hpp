@@ -0,0 +1,147 @@
+#pragma once
+
+#include "TypeIndex.hpp"
+#include "Assertions.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//
+// INFO: Base of hierarchy dispatched by 'DoubleDispatcher', object stores index
+// of its dynamic type, so dispatch doesn't need 'dynamic_cast' or virtual call.
+// Derived classes pass 'dispatchIndexOf<Root, Derived>()' to constructor
+//
+// Usage:
+//   class Collider : public DispatchTarget<Collider> {
+//   protected:
+//       using DispatchTarget::DispatchTarget;
+//   };
+//
+//   class Ship : public Collider {
+//   public:
+//       Ship() : Collider(dispatchIndexOf<Collider, Ship>()) {}
+//   };
+//
+template <typename Root>
+class DispatchTarget : public TypeIndexed<DispatchTarget<Root>> {
+public:
+    TypeIndex dispatchIndex() const { return this->typeIndex(); }
+
+protected:
+    explicit DispatchTarget(TypeIndex index)
+        : TypeIndexed<DispatchTarget<Root>>(index)
+    {
+    }
+};
+
+template <typename Root, typename T>
+TypeIndex dispatchIndexOf()
+{
+    return orderedTypeIndex<DispatchTarget<Root>, T>();
+}
+
+//
+// INFO: Dense N x N table of handlers indexed by dispatch indices of both
+// arguments, dispatch is two index loads, one table load and indirect call.
+// Handler registered for (A, B) also handles (B, A) with swapped arguments,
+// unless (B, A) has its own handler. Pairs without handler go to 'fallback'.
+// Handlers are matched by exact dynamic type
+//
+// Usage:
+//   DoubleDispatcher<Collider, void, float> collisions;
+//   collisions.add<Ship, Asteroid, &collide>(); // void collide(Ship&, Asteroid&, float dt)
+//   collisions.dispatch(*a, *b, dt);
+//
+template <typename Root, typename Result = void, typename... Args>
+class DoubleDispatcher {
+public:
+    using Handler = Result (*)(Root&, Root&, Args...);
+
+    explicit DoubleDispatcher(Handler fallback = &DoubleDispatcher::ignore)
+        : m_fallback(fallback)
+    {
+    }
+
+    template <typename A, typename B, Result (*Fn)(A&, B&, Args...)>
+    void add()
+    {
+        const TypeIndex a = dispatchIndexOf<Root, A>();
+        const TypeIndex b = dispatchIndexOf<Root, B>();
+        reserve(std::max(a, b) + 1);
+
+        m_table[a * m_stride + b] = &DoubleDispatcher::thunk<A, B, Fn>;
+        m_explicit[a * m_stride + b] = true;
+
+        if (!m_explicit[b * m_stride + a]) {
+            m_table[b * m_stride + a] = &DoubleDispatcher::swappedThunk<A, B, Fn>;
+        }
+    }
+
+    Result dispatch(Root& a, Root& b, Args... args) const
+    {
+        const TypeIndex indexA = a.dispatchIndex();
+        const TypeIndex indexB = b.dispatchIndex();
+        if (indexA >= m_stride || indexB >= m_stride) {
+            return m_fallback(a, b, std::forward<Args>(args)...);
+        }
+        return m_table[indexA * m_stride + indexB](a, b, std::forward<Args>(args)...);
+    }
+
+    template <typename A, typename B>
+    bool hasHandler() const
+    {
+        const TypeIndex a = dispatchIndexOf<Root, A>();
+        const TypeIndex b = dispatchIndexOf<Root, B>();
+        return a < m_stride && b < m_stride && m_table[a * m_stride + b] != m_fallback;
+    }
+
+private:
+    static Result ignore(Root&, Root&, Args...) { return Result(); }
+
+    template <typename A, typename B, Result (*Fn)(A&, B&, Args...)>
+    static Result thunk(Root& a, Root& b, Args... args)
+    {
+        return Fn(static_cast<A&>(a), static_cast<B&>(b), std::forward<Args>(args)...);
+    }
+
+    template <typename A, typename B, Result (*Fn)(A&, B&, Args...)>
+    static Result swappedThunk(Root& b, Root& a, Args... args)
+    {
+        return Fn(static_cast<A&>(a), static_cast<B&>(b), std::forward<Args>(args)...);
+    }
+
+    //
+    // INFO: Table grows by powers of two, so registering types one by one is cheap
+    //
+    void reserve(size_t types)
+    {
+        if (types <= m_stride) {
+            return;
+        }
+
+        size_t stride = m_stride == 0 ? 8 : m_stride;
+        while (stride < types) {
+            stride *= 2;
+        }
+
+        std::vector<Handler> table(stride * stride, m_fallback);
+        std::vector<bool> explicitHandlers(stride * stride, false);
+        for (size_t a = 0; a < m_stride; ++a) {
+            for (size_t b = 0; b < m_stride; ++b) {
+                table[a * stride + b] = m_table[a * m_stride + b];
+                explicitHandlers[a * stride + b] = m_explicit[a * m_stride + b];
+            }
+        }
+
+        m_table = std::move(table);
+        m_explicit = std::move(explicitHandlers);
+        m_stride = stride;
+    }
+
+private:
+    Handler m_fallback;
+    size_t m_stride = 0;
+    std::vector<Handler> m_table;
+    std::vector<bool> m_explicit;
+};
@@ -0,0 +1,59 @@
+#include "EntityRandom.hpp"
+#include "Hash.hpp"
+
+EntityRandomTraits::GeneratorType& EntityRandomTraits::generator()
+{
+    thread_local EntityRandomTraits::GeneratorType s_entityGenerator = [] {
+        std::random_device device;
+        return EntityRandomTraits::GeneratorType((static_cast<uint64_t>(device()) << 32u) | device());
+    }();
+    return s_entityGenerator;
+}
+
+EntityRandomStreams::EntityRandomStreams(uint64_t seed)
+    : m_seed(seed)
+{
+}
+
+uint32_t EntityRandomStreams::add(uint64_t entityId)
+{
+    m_keys.push_back(mixHash(entityId, m_seed));
+    m_positions.push_back(0);
+    return static_cast<uint32_t>(m_keys.size() - 1);
+}
+
+void EntityRandomStreams::reserve(size_t count)
+{
+    m_keys.reserve(count);
+    m_positions.reserve(count);
+}
+
+void EntityRandomStreams::clear()
+{
+    m_keys.clear();
+    m_positions.clear();
+}
+
+void EntityRandomStreams::seek(uint32_t slot, uint32_t frame, uint32_t draw)
+{
+    m_positions[slot] = (static_cast<uint64_t>(frame) << 32u) | draw;
+}
+
+void EntityRandomStreams::seekAll(uint32_t frame)
+{
+    const uint64_t position = static_cast<uint64_t>(frame) << 32u;
+    for (uint64_t& value : m_positions) {
+        value = position;
+    }
+}
+
+void EntityRandomStreams::nextAll(uint64_t* out)
+{
+    const size_t count = m_keys.size();
+    const uint64_t* keys = m_keys.data();
+    uint64_t* positions = m_positions.data();
+
+    for (size_t slot = 0; slot < count; ++slot) {
+        out[slot] = EntityRandomStream::valueAt(keys[slot], positions[slot]++);
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ConstexprRandom.hpp"
+#include "Random.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//
+// INFO: Counter-based generator for rollback simulation, 16 bytes of state:
+// entity key and position '(frame << 32) | draw'. Value at position is a hash
+// of key and position, so 'seek(frame, draw)' is O(1) and re-simulated frame
+// draws exactly the same values. Entity key should come from data shared by
+// all peers, e.g. network id and match seed, see 'EntityRandomStreams'.
+//
+// Raw values are the same on every platform. Peers that must agree map them
+// with 'ConstexprRandom', its functions are plain integer and float
+// arithmetic:
+//   EntityRandomStream stream(key);
+//   stream.seek(frame, 0);
+//   auto spread = ConstexprRandom::uniformf(-0.1f, 0.1f, stream);
+//
+// Stream satisfies UniformRandomBitGenerator, so 'RandomBase' functions take
+// it too ('EntityRandom::normalf'), but they go through 'std::' distributions.
+// Their mapping is implementation-defined, libstdc++, libc++ and MSVC give
+// different values from the same stream, so such draws are rollback-safe only
+// when all peers run the same standard library build. They may also consume
+// more than one value per call, keep draw index per frame, not per call
+//
+class EntityRandomStream
+{
+public:
+    using result_type = uint64_t;
+
+    constexpr EntityRandomStream() = default;
+
+    constexpr explicit EntityRandomStream(uint64_t key, uint64_t position = 0)
+        : m_key(key)
+        , m_position(position)
+    {
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    constexpr result_type operator()() { return valueAt(m_key, m_position++); }
+
+    //
+    // INFO: Position is mixed before key is applied, so keys that differ
+    // in few bits don't give shifted copies of the same sequence
+    //
+    static constexpr result_type valueAt(uint64_t key, uint64_t position)
+    {
+        return SplitMix64::mix(SplitMix64::mix(position) ^ key);
+    }
+
+    constexpr void seek(uint32_t frame, uint32_t draw = 0) { m_position = (static_cast<uint64_t>(frame) << 32u) | draw; }
+    constexpr void discard(unsigned long long count) { m_position += count; }
+
+    constexpr uint64_t key() const { return m_key; }
+    constexpr uint64_t position() const { return m_position; }
+    constexpr uint32_t frame() const { return static_cast<uint32_t>(m_position >> 32u); }
+    constexpr uint32_t draw() const { return static_cast<uint32_t>(m_position); }
+
+    constexpr bool operator==(const EntityRandomStream& other) const
+    {
+        return m_key == other.m_key && m_position == other.m_position;
+    }
+
+    constexpr bool operator!=(const EntityRandomStream& other) const { return !(*this == other); }
+
+private:
+    uint64_t m_key = 0x6c62272e07bb0142ull;
+    uint64_t m_position = 0;
+};
+
+static_assert(sizeof(EntityRandomStream) == 16, "Entity stream must stay compact.");
+
+//
+// INFO: Default generator is per thread and only useful for tests,
+// pass stream of entity explicitly
+//
+struct EntityRandomTraits
+{
+    using GeneratorType = EntityRandomStream;
+    static GeneratorType& generator();
+};
+
+using EntityRandom = RandomBase<EntityRandomTraits>;
+
+//
+// INFO: Streams of many entities as struct-of-arrays, keys are
+// 'mixHash(entityId, matchSeed)', so peers get the same streams from the
+// same ids. Rollback is 'seekAll(frame)', one pass over positions.
+//
+// Usage:
+//   EntityRandomStreams streams(matchSeed);
+//   auto slot = streams.add(networkId);
+//   auto stream = streams.stream(slot);
+//   auto damage = ConstexprRandom::uniform(10, 20, stream);
+//   streams.store(slot, stream);
+//
+class EntityRandomStreams {
+public:
+    explicit EntityRandomStreams(uint64_t seed = 0);
+
+    uint32_t add(uint64_t entityId);
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return m_keys.size(); }
+
+    EntityRandomStream stream(uint32_t slot) const { return EntityRandomStream(m_keys[slot], m_positions[slot]); }
+    void store(uint32_t slot, const EntityRandomStream& stream) { m_positions[slot] = stream.position(); }
+
+    void seek(uint32_t slot, uint32_t frame, uint32_t draw = 0);
+    void seekAll(uint32_t frame);
+
+    //
+    // INFO: One value per entity, 'out[slot]', positions advance by one
+    //
+    void nextAll(uint64_t* out);
+
+private:
+    uint64_t m_seed;
+    std::vector<uint64_t> m_keys;
+    std::vector<uint64_t> m_positions;
+};
@@ -0,0 +1,151 @@
+#include "EpochReclamation.hpp"
+
+//
+// INFO: Record is handed back on thread exit with its limbo lists,
+// next thread that takes the record reclaims them
+//
+struct ThreadRecord {
+    EpochReclamation::Record* record = nullptr;
+
+    ~ThreadRecord()
+    {
+        if (record) {
+            epochReclamation().releaseRecord(record);
+        }
+    }
+};
+
+namespace {
+constexpr size_t RetiresPerAdvance = 64;
+
+thread_local ThreadRecord t_threadRecord;
+}
+
+EpochReclamation& epochReclamation()
+{
+    static EpochReclamation instance;
+    return instance;
+}
+
+EpochReclamation::Guard::Guard()
+{
+    auto& reclamation = epochReclamation();
+    if (!t_threadRecord.record) {
+        t_threadRecord.record = reclamation.acquireRecord();
+    }
+    reclamation.pin(t_threadRecord.record);
+}
+
+EpochReclamation::Guard::~Guard()
+{
+    epochReclamation().unpin(t_threadRecord.record);
+}
+
+uint64_t EpochReclamation::epoch() const
+{
+    return m_globalEpoch.load(std::memory_order_acquire);
+}
+
+void EpochReclamation::retire(void* object, Reclaimer reclaimer)
+{
+    if (!t_threadRecord.record) {
+        t_threadRecord.record = acquireRecord();
+    }
+    Record* record = t_threadRecord.record;
+
+    //
+    // INFO: Tag with global epoch at retire time, not with epoch pinned by
+    // this thread. Reader pinned before unlink has epoch <= tag and blocks
+    // global epoch at 'tag + 1', so 'tag + 2' is safe to reclaim
+    //
+    const uint64_t globalEpoch = m_globalEpoch.load(std::memory_order_seq_cst);
+    const size_t bucket = globalEpoch % 3;
+    if (record->limboEpoch[bucket] != globalEpoch) {
+        reclaim(record->limbo[bucket]);
+        record->limboEpoch[bucket] = globalEpoch;
+    }
+    record->limbo[bucket].push_back({ object, reclaimer });
+
+    if (++record->retiredSinceAdvance >= RetiresPerAdvance) {
+        record->retiredSinceAdvance = 0;
+        tryAdvance();
+        collect(record, m_globalEpoch.load(std::memory_order_seq_cst));
+    }
+}
+
+EpochReclamation::Record* EpochReclamation::acquireRecord()
+{
+    for (Record* record = m_records.load(std::memory_order_acquire); record; record = record->next) {
+        bool expected = false;
+        if (!record->inUse.load(std::memory_order_relaxed)
+            && record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return record;
+        }
+    }
+
+    //
+    // INFO: Records are never freed, count is bounded by peak thread count
+    //
+    auto* record = new Record;
+    Record* head = m_records.load(std::memory_order_relaxed);
+    do {
+        record->next = head;
+    } while (!m_records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    return record;
+}
+
+void EpochReclamation::releaseRecord(Record* record)
+{
+    record->nesting = 0;
+    record->pinnedEpoch.store(0, std::memory_order_release);
+    record->inUse.store(false, std::memory_order_release);
+}
+
+void EpochReclamation::pin(Record* record)
+{
+    if (record->nesting++ != 0) {
+        return;
+    }
+
+    const uint64_t globalEpoch = m_globalEpoch.load(std::memory_order_seq_cst);
+    record->pinnedEpoch.store((globalEpoch << 1u) | 1u, std::memory_order_seq_cst);
+    collect(record, globalEpoch);
+}
+
+void EpochReclamation::unpin(Record* record)
+{
+    if (--record->nesting == 0) {
+        record->pinnedEpoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochReclamation::tryAdvance()
+{
+    uint64_t globalEpoch = m_globalEpoch.load(std::memory_order_seq_cst);
+
+    for (Record* record = m_records.load(std::memory_order_acquire); record; record = record->next) {
+        const uint64_t pinned = record->pinnedEpoch.load(std::memory_order_seq_cst);
+        if ((pinned & 1u) != 0 && (pinned >> 1u) != globalEpoch) {
+            return;
+        }
+    }
+
+    m_globalEpoch.compare_exchange_strong(globalEpoch, globalEpoch + 1, std::memory_order_seq_cst);
+}
+
+void EpochReclamation::collect(Record* record, uint64_t globalEpoch)
+{
+    for (size_t bucket = 0; bucket < 3; ++bucket) {
+        if (!record->limbo[bucket].empty() && record->limboEpoch[bucket] + 2 <= globalEpoch) {
+            reclaim(record->limbo[bucket]);
+        }
+    }
+}
+
+void EpochReclamation::reclaim(std::vector<Retired>& retired)
+{
+    for (const auto& item : retired) {
+        item.reclaimer(item.object);
+    }
+    retired.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// INFO: Epoch based memory reclamation for lock-free structures. Readers pin
+// current epoch with 'Guard', unlinked objects are passed to 'retire' and
+// reclaimed after every thread that could still see them has left its guard.
+// Object must be unreachable for new readers when it is retired
+//
+// Usage:
+//   EpochReclamation::Guard guard;
+//   ... read shared nodes ...
+//   epochReclamation().retire(unlinkedNode, &reclaimNode);
+//
+class EpochReclamation {
+public:
+    using Reclaimer = void (*)(void* object);
+
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    EpochReclamation() = default;
+
+    EpochReclamation(const EpochReclamation&) = delete;
+    EpochReclamation& operator=(const EpochReclamation&) = delete;
+
+    void retire(void* object, Reclaimer reclaimer);
+
+    uint64_t epoch() const;
+
+private:
+    struct Retired {
+        void* object;
+        Reclaimer reclaimer;
+    };
+
+    struct Record {
+        //
+        // INFO: '(epoch << 1) | 1' while pinned, zero otherwise
+        //
+        std::atomic<uint64_t> pinnedEpoch { 0 };
+        std::atomic<bool> inUse { true };
+        Record* next = nullptr;
+        int nesting = 0;
+        size_t retiredSinceAdvance = 0;
+        std::vector<Retired> limbo[3];
+        uint64_t limboEpoch[3] = {};
+    };
+
+    friend class Guard;
+    friend struct ThreadRecord;
+
+    Record* acquireRecord();
+    void releaseRecord(Record* record);
+
+    void pin(Record* record);
+    void unpin(Record* record);
+
+    void tryAdvance();
+    void collect(Record* record, uint64_t globalEpoch);
+    static void reclaim(std::vector<Retired>& retired);
+
+private:
+    std::atomic<uint64_t> m_globalEpoch { 1 };
+    std::atomic<Record*> m_records { nullptr };
+};
+
+EpochReclamation& epochReclamation();
@@ -0,0 +1,169 @@
+#include "ExperimentBucketing.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+//
+// INFO: Largest remainder rounding, bucket counts sum exactly to 'total'
+// and ties go to the lower variant, so table is the same in every process.
+// Empty result when weights are empty, negative, not finite or all zero
+//
+std::vector<uint32_t> apportion(const std::vector<double>& weights, uint32_t total)
+{
+    double sum = 0.0;
+    for (double weight : weights) {
+        if (!(weight >= 0.0) || !std::isfinite(weight)) {
+            return {};
+        }
+        sum += weight;
+    }
+    if (!(sum > 0.0) || !std::isfinite(sum)) {
+        return {};
+    }
+
+    std::vector<uint32_t> counts(weights.size());
+    std::vector<double> remainders(weights.size());
+    uint32_t assigned = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        const double exact = weights[i] / sum * total;
+        counts[i] = static_cast<uint32_t>(std::floor(exact));
+        remainders[i] = exact - counts[i];
+        assigned += counts[i];
+    }
+
+    std::vector<size_t> order(weights.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&remainders](size_t a, size_t b) {
+        return remainders[a] > remainders[b];
+    });
+
+    for (size_t i = 0; assigned < total; ++i, ++assigned) {
+        ++counts[order[i % order.size()]];
+    }
+    return counts;
+}
+}
+
+ExperimentBucketing::ExperimentBucketing(uint64_t seed)
+    : m_seed(seed)
+{
+}
+
+uint32_t ExperimentBucketing::addLayer(std::string_view name)
+{
+    Layer layer;
+    layer.salt = hashBytes(name.data(), name.size(), m_seed);
+    layer.owners.assign(BucketCount, NoExperiment);
+
+    m_layers.push_back(std::move(layer));
+    return static_cast<uint32_t>(m_layers.size() - 1);
+}
+
+int32_t ExperimentBucketing::addExperiment(uint32_t layer, std::string_view name, double traffic, const std::vector<double>& weights)
+{
+    if (layer >= m_layers.size() || !(traffic >= 0.0 && traffic <= 1.0) || m_experiments.size() >= NoExperiment) {
+        return NotEnrolled;
+    }
+
+    auto& owner = m_layers[layer];
+    const auto buckets = static_cast<uint32_t>(std::lround(traffic * BucketCount));
+    if (buckets > BucketCount - owner.used || weights.size() > NoExperiment) {
+        return NotEnrolled;
+    }
+
+    const auto counts = apportion(weights, BucketCount);
+    if (counts.empty()) {
+        return NotEnrolled;
+    }
+
+    const auto id = static_cast<int32_t>(m_experiments.size());
+    std::fill_n(owner.owners.begin() + owner.used, buckets, static_cast<uint16_t>(id));
+    owner.used += buckets;
+
+    Experiment experiment;
+    experiment.salt = hashBytes(name.data(), name.size(), owner.salt);
+    experiment.layer = layer;
+    experiment.variants.reserve(BucketCount);
+    for (size_t variant = 0; variant < counts.size(); ++variant) {
+        experiment.variants.insert(experiment.variants.end(), counts[variant], static_cast<uint16_t>(variant));
+    }
+
+    m_experiments.push_back(std::move(experiment));
+    return id;
+}
+
+int32_t ExperimentBucketing::variant(uint32_t experiment, uint64_t user) const
+{
+    if (experiment >= m_experiments.size()) {
+        return NotEnrolled;
+    }
+
+    const auto& entry = m_experiments[experiment];
+    const auto& layer = m_layers[entry.layer];
+
+    if (layer.owners[bucketOf(mixHash(user, layer.salt))] != experiment) {
+        return NotEnrolled;
+    }
+    return entry.variants[bucketOf(mixHash(user, entry.salt))];
+}
+
+void ExperimentBucketing::variants(uint32_t experiment, const uint64_t* users, int32_t* out, size_t count) const
+{
+    if (experiment >= m_experiments.size()) {
+        std::fill_n(out, count, NotEnrolled);
+        return;
+    }
+
+    const auto& entry = m_experiments[experiment];
+    const uint16_t* owners = m_layers[entry.layer].owners.data();
+    const uint16_t* variants = entry.variants.data();
+    const uint64_t layerSalt = m_layers[entry.layer].salt;
+    const uint64_t salt = entry.salt;
+
+    for (size_t i = 0; i < count; ++i) {
+        const bool enrolled = owners[bucketOf(mixHash(users[i], layerSalt))] == experiment;
+        const int32_t chosen = variants[bucketOf(mixHash(users[i], salt))];
+        out[i] = enrolled ? chosen : NotEnrolled;
+    }
+}
+
+int32_t ExperimentBucketing::experimentOf(uint32_t layer, uint64_t user) const
+{
+    if (layer >= m_layers.size()) {
+        return NotEnrolled;
+    }
+
+    const auto& entry = m_layers[layer];
+    const uint16_t owner = entry.owners[bucketOf(mixHash(user, entry.salt))];
+    return owner == NoExperiment ? NotEnrolled : owner;
+}
+
+void ExperimentBucketing::experimentsOf(uint32_t layer, const uint64_t* users, int32_t* out, size_t count) const
+{
+    if (layer >= m_layers.size()) {
+        std::fill_n(out, count, NotEnrolled);
+        return;
+    }
+
+    const uint16_t* owners = m_layers[layer].owners.data();
+    const uint64_t salt = m_layers[layer].salt;
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint16_t owner = owners[bucketOf(mixHash(users[i], salt))];
+        out[i] = owner == NoExperiment ? NotEnrolled : owner;
+    }
+}
+
+uint64_t ExperimentBucketing::userKey(std::string_view user) const
+{
+    return hashBytes(user.data(), user.size(), m_seed);
+}
+
+uint32_t ExperimentBucketing::freeBuckets(uint32_t layer) const
+{
+    return layer < m_layers.size() ? BucketCount - m_layers[layer].used : 0;
+}
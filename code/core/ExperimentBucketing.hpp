@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//
+// INFO: Stateless A/B assignment, variant of user is a function of
+// (seed, layer, experiment, user) only, so every process computes the same
+// answer without storage or coordination. Hashes use fixed seed, not
+// 'hashSeed()', results are bit-identical between processes and restarts.
+//
+// Every layer splits users into 'BucketCount' buckets by salted hash, each
+// experiment of layer owns disjoint range of buckets ('traffic'), so
+// experiments of one layer are mutually exclusive and experiments of
+// different layers are independent. Inside experiment user is hashed again
+// with experiment salt and prepared table maps bucket to variant by weights.
+//
+// Buckets are handed out in order of 'addExperiment' calls, configure
+// layers and experiments in the same order in every process. Configuration
+// isn't thread safe, assignment is const and may run from any thread
+//
+// Usage:
+//   services().emplaceService<ExperimentBucketing, ExperimentBucketing>();
+//   auto& bucketing = *service<ExperimentBucketing>();
+//   auto layer = bucketing.addLayer("checkout");
+//   auto button = bucketing.addExperiment(layer, "button-color", 0.2, { 1.0, 1.0 });
+//   if (bucketing.variant(button, userId) == 1) { ... }
+//
+class ExperimentBucketing {
+public:
+    static constexpr uint32_t BucketCount = 10000;
+    static constexpr int32_t NotEnrolled = -1;
+    static constexpr uint64_t DefaultSeed = 0x3c6ef372fe94f82bull;
+
+    explicit ExperimentBucketing(uint64_t seed = DefaultSeed);
+
+    uint32_t addLayer(std::string_view name);
+    //
+    // INFO: Returns 'NotEnrolled' and changes nothing when layer is unknown,
+    // traffic isn't in [0, 1] or exceeds free traffic of layer, or weights are
+    // empty, negative or all zero. Unknown ids are answered with 'NotEnrolled'
+    //
+    int32_t addExperiment(uint32_t layer, std::string_view name, double traffic, const std::vector<double>& weights);
+
+    int32_t variant(uint32_t experiment, uint64_t user) const;
+    int32_t variant(uint32_t experiment, std::string_view user) const { return variant(experiment, userKey(user)); }
+    void variants(uint32_t experiment, const uint64_t* users, int32_t* out, size_t count) const;
+
+    //
+    // INFO: Experiment of layer that owns bucket of user or 'NotEnrolled'
+    //
+    int32_t experimentOf(uint32_t layer, uint64_t user) const;
+    void experimentsOf(uint32_t layer, const uint64_t* users, int32_t* out, size_t count) const;
+
+    uint64_t userKey(std::string_view user) const;
+
+    size_t layerCount() const { return m_layers.size(); }
+    size_t experimentCount() const { return m_experiments.size(); }
+    uint32_t freeBuckets(uint32_t layer) const;
+
+private:
+    static constexpr uint16_t NoExperiment = 0xffff;
+
+    static uint32_t bucketOf(uint64_t hash)
+    {
+        return static_cast<uint32_t>(((hash >> 32u) * BucketCount) >> 32u);
+    }
+
+    struct Layer {
+        uint64_t salt;
+        uint32_t used = 0;
+        std::vector<uint16_t> owners;
+    };
+
+    struct Experiment {
+        uint64_t salt;
+        uint32_t layer;
+        std::vector<uint16_t> variants;
+    };
+
+private:
+    uint64_t m_seed;
+    std::vector<Layer> m_layers;
+    std::vector<Experiment> m_experiments;
+};
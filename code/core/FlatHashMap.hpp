@@ -0,0 +1,541 @@
+#pragma once
+
+#include "Assertions.hpp"
+#include "Bits.hpp"
+#include "Hash.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALLY_FLAT_HASH_SSE2
+#endif
+
+//
+// INFO: One control byte per slot, 'Empty' and 'Deleted' have sign bit set,
+// full slots store low 7 bits of hash. Table is split into aligned groups
+// of 16 control bytes which are matched at once with SSE2
+//
+enum : int8_t {
+    ControlEmpty = -128,
+    ControlDeleted = -2
+};
+
+class ControlGroup {
+public:
+    static constexpr size_t Width = 16;
+
+    explicit ControlGroup(const int8_t* control)
+    {
+#if defined(ALLY_FLAT_HASH_SSE2)
+        m_control = _mm_load_si128(reinterpret_cast<const __m128i*>(control));
+#else
+        m_control = control;
+#endif
+    }
+
+    uint32_t match(int8_t hash) const
+    {
+#if defined(ALLY_FLAT_HASH_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(hash), m_control)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < Width; ++i) {
+            mask |= static_cast<uint32_t>(m_control[i] == hash) << i;
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t matchEmpty() const { return match(ControlEmpty); }
+
+    uint32_t matchEmptyOrDeleted() const
+    {
+#if defined(ALLY_FLAT_HASH_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_epi8(m_control));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < Width; ++i) {
+            mask |= static_cast<uint32_t>(m_control[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+private:
+#if defined(ALLY_FLAT_HASH_SSE2)
+    __m128i m_control;
+#else
+    const int8_t* m_control;
+#endif
+};
+
+//
+// INFO: Open addressing map in SwissTable style. Keys are hashed with per-process
+// seed (see 'hashSeed'), lookup is heterogeneous when 'Hash' is transparent e.g.
+// 'FlatHashMap<std::string, T>::find(std::string_view)'
+//
+// 'reserveFixed' switches map to no-rehash mode: after it pointers and iterators
+// stay valid on insert. Insert into full fixed map fails and returns
+// '{ end(), false }', 'operator[]' asserts, check 'try_emplace' result instead
+//
+// Keys are stored as 'std::pair<Key, Value>', don't modify key through iterator
+//
+template <typename Key, typename Value, typename Hash = SeededHash<Key>, typename Equal = std::equal_to<>>
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = Equal;
+
+    template <bool IsConst>
+    class IteratorBase {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+        IteratorBase() = default;
+
+        template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        IteratorBase(const IteratorBase<OtherConst>& other)
+            : m_control(other.m_control)
+            , m_controlEnd(other.m_controlEnd)
+            , m_slot(other.m_slot)
+        {
+        }
+
+        reference operator*() const { return *m_slot; }
+        pointer operator->() const { return m_slot; }
+
+        IteratorBase& operator++()
+        {
+            ++m_control;
+            ++m_slot;
+            skipFree();
+            return *this;
+        }
+
+        IteratorBase operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const IteratorBase& a, const IteratorBase& b) { return a.m_control == b.m_control; }
+        friend bool operator!=(const IteratorBase& a, const IteratorBase& b) { return a.m_control != b.m_control; }
+
+    private:
+        friend class FlatHashMap;
+        template <bool>
+        friend class IteratorBase;
+
+        IteratorBase(const int8_t* control, const int8_t* controlEnd, pointer slot)
+            : m_control(control)
+            , m_controlEnd(controlEnd)
+            , m_slot(slot)
+        {
+            skipFree();
+        }
+
+        void skipFree()
+        {
+            while (m_control != m_controlEnd && *m_control < 0) {
+                ++m_control;
+                ++m_slot;
+            }
+        }
+
+    private:
+        const int8_t* m_control = nullptr;
+        const int8_t* m_controlEnd = nullptr;
+        pointer m_slot = nullptr;
+    };
+
+    using iterator = IteratorBase<false>;
+    using const_iterator = IteratorBase<true>;
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(size_t count)
+    {
+        reserve(count);
+    }
+
+    FlatHashMap(const FlatHashMap& other)
+        : m_hash(other.m_hash)
+        , m_equal(other.m_equal)
+    {
+        reserve(other.m_size);
+        for (const auto& item : other) {
+            insertUnique(hashOf(item.first), item);
+        }
+        m_fixed = other.m_fixed;
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+        : m_hash(other.m_hash)
+        , m_equal(other.m_equal)
+    {
+        swap(other);
+    }
+
+    FlatHashMap& operator=(FlatHashMap other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~FlatHashMap()
+    {
+        destroyAll();
+        deallocate();
+    }
+
+    void swap(FlatHashMap& other) noexcept
+    {
+        using std::swap;
+        swap(m_control, other.m_control);
+        swap(m_slots, other.m_slots);
+        swap(m_capacity, other.m_capacity);
+        swap(m_size, other.m_size);
+        swap(m_growthLeft, other.m_growthLeft);
+        swap(m_fixed, other.m_fixed);
+        swap(m_hash, other.m_hash);
+        swap(m_equal, other.m_equal);
+    }
+
+    iterator begin() { return iterator(m_control, m_control + m_capacity, m_slots); }
+    iterator end() { return iterator(m_control + m_capacity, m_control + m_capacity, m_slots + m_capacity); }
+    const_iterator begin() const { return const_iterator(m_control, m_control + m_capacity, m_slots); }
+    const_iterator end() const { return const_iterator(m_control + m_capacity, m_control + m_capacity, m_slots + m_capacity); }
+
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool isFixed() const { return m_fixed; }
+
+    void clear()
+    {
+        destroyAll();
+        resetControl();
+    }
+
+    void reserve(size_t count)
+    {
+        const size_t required = capacityFor(count);
+        if (required > m_capacity) {
+            rehash(required);
+        }
+    }
+
+    void reserveFixed(size_t count)
+    {
+        reserve(count);
+        m_fixed = true;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        return emplaceKey(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args)
+    {
+        return emplaceKey(std::move(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& item)
+    {
+        return emplaceKey(item.first, item.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& item)
+    {
+        return emplaceKey(std::move(item.first), std::move(item.second));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type item(std::forward<Args>(args)...);
+        return emplaceKey(std::move(item.first), std::move(item.second));
+    }
+
+    Value& operator[](const Key& key) { return checkedValue(try_emplace(key).first); }
+    Value& operator[](Key&& key) { return checkedValue(try_emplace(std::move(key)).first); }
+
+    iterator find(const Key& key) { return iteratorAt(findIndex(key)); }
+    const_iterator find(const Key& key) const { return iteratorAt(findIndex(key)); }
+    bool contains(const Key& key) const { return findIndex(key) != NotFound; }
+    size_t count(const Key& key) const { return contains(key) ? 1 : 0; }
+    size_t erase(const Key& key) { return eraseKey(key); }
+
+    template <typename K, typename H = Hash, typename = typename H::is_transparent>
+    iterator find(const K& key) { return iteratorAt(findIndex(key)); }
+
+    template <typename K, typename H = Hash, typename = typename H::is_transparent>
+    const_iterator find(const K& key) const { return iteratorAt(findIndex(key)); }
+
+    template <typename K, typename H = Hash, typename = typename H::is_transparent>
+    bool contains(const K& key) const { return findIndex(key) != NotFound; }
+
+    template <typename K, typename H = Hash, typename = typename H::is_transparent>
+    size_t erase(const K& key) { return eraseKey(key); }
+
+    void erase(const_iterator position)
+    {
+        ally_assert(position != end());
+        eraseAt(static_cast<size_t>(position.m_control - m_control));
+    }
+
+    //
+    // INFO: Exact match for 'erase(find(key))', otherwise transparent 'erase(const K&)'
+    // deduces 'K = iterator' and wins over conversion to 'const_iterator'
+    //
+    void erase(iterator position) { erase(const_iterator(position)); }
+
+private:
+    static constexpr size_t NotFound = static_cast<size_t>(-1);
+
+    static size_t capacityFor(size_t count)
+    {
+        //
+        // INFO: Max load factor is 7/8
+        //
+        const size_t slots = count + (count + 6) / 7;
+        const size_t capacity = static_cast<size_t>(roundUpToPowerOfTwo(slots));
+        return capacity < ControlGroup::Width ? ControlGroup::Width : capacity;
+    }
+
+    static size_t growthFor(size_t capacity) { return capacity - capacity / 8; }
+
+    static int8_t shortHash(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+    template <typename K>
+    size_t hashOf(const K& key) const
+    {
+        return static_cast<size_t>(m_hash(key));
+    }
+
+    size_t groupMask() const { return m_capacity / ControlGroup::Width - 1; }
+
+    //
+    // INFO: Triangular probing over groups visits every group once
+    // when group count is a power of two
+    //
+    template <typename K>
+    size_t findIndex(const K& key) const
+    {
+        if (m_size == 0) {
+            return NotFound;
+        }
+
+        const size_t hash = hashOf(key);
+        const int8_t h2 = shortHash(hash);
+        const size_t mask = groupMask();
+
+        size_t group = (hash >> 7u) & mask;
+        for (size_t step = 1; step <= mask + 1; ++step) {
+            const size_t base = group * ControlGroup::Width;
+            const ControlGroup control(m_control + base);
+
+            for (uint32_t match = control.match(h2); match != 0; match &= match - 1) {
+                const size_t index = base + static_cast<size_t>(countTrailingZeros(match));
+                if (m_equal(m_slots[index].first, key)) {
+                    return index;
+                }
+            }
+
+            if (control.matchEmpty() != 0) {
+                return NotFound;
+            }
+
+            group = (group + step) & mask;
+        }
+
+        return NotFound;
+    }
+
+    size_t findInsertIndex(size_t hash) const
+    {
+        const size_t mask = groupMask();
+
+        size_t group = (hash >> 7u) & mask;
+        for (size_t step = 1;; ++step) {
+            const size_t base = group * ControlGroup::Width;
+            const uint32_t free = ControlGroup(m_control + base).matchEmptyOrDeleted();
+            if (free != 0) {
+                return base + static_cast<size_t>(countTrailingZeros(free));
+            }
+            group = (group + step) & mask;
+        }
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplaceKey(K&& key, Args&&... args)
+    {
+        const size_t existing = findIndex(key);
+        if (existing != NotFound) {
+            return { iteratorAt(existing), false };
+        }
+
+        const size_t hash = hashOf(key);
+        const size_t index = insertUnique(hash,
+            std::piecewise_construct,
+            std::forward_as_tuple(std::forward<K>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iteratorAt(index), index != NotFound };
+    }
+
+    Value& checkedValue(iterator position)
+    {
+        ally_assert(position != end(), "fixed capacity exceeded");
+        return position->second;
+    }
+
+    template <typename... Args>
+    size_t insertUnique(size_t hash, Args&&... args)
+    {
+        if (m_growthLeft == 0 && !(m_fixed && m_size < m_capacity)) {
+            //
+            // INFO: Rehash would invalidate pointers into fixed map, fail instead
+            //
+            if (m_fixed) {
+                return NotFound;
+            }
+            const bool manyDeleted = m_capacity != 0 && m_size * 2 < growthFor(m_capacity);
+            rehash(m_capacity == 0 ? ControlGroup::Width : (manyDeleted ? m_capacity : m_capacity * 2));
+        }
+
+        const size_t index = findInsertIndex(hash);
+        if (m_control[index] == ControlEmpty && m_growthLeft > 0) {
+            --m_growthLeft;
+        }
+
+        new (m_slots + index) value_type(std::forward<Args>(args)...);
+        m_control[index] = shortHash(hash);
+        ++m_size;
+        return index;
+    }
+
+    template <typename K>
+    size_t eraseKey(const K& key)
+    {
+        const size_t index = findIndex(key);
+        if (index == NotFound) {
+            return 0;
+        }
+        eraseAt(index);
+        return 1;
+    }
+
+    void eraseAt(size_t index)
+    {
+        m_slots[index].~value_type();
+        --m_size;
+
+        //
+        // INFO: Lookup stops at group with empty slot, such group never was full
+        // since last rehash, so probe sequences can't pass through it
+        //
+        const size_t base = index - index % ControlGroup::Width;
+        if (ControlGroup(m_control + base).matchEmpty() != 0) {
+            m_control[index] = ControlEmpty;
+            ++m_growthLeft;
+        } else {
+            m_control[index] = ControlDeleted;
+        }
+    }
+
+    iterator iteratorAt(size_t index)
+    {
+        return index == NotFound ? end() : iterator(m_control + index, m_control + m_capacity, m_slots + index);
+    }
+
+    const_iterator iteratorAt(size_t index) const
+    {
+        return index == NotFound ? end() : const_iterator(m_control + index, m_control + m_capacity, m_slots + index);
+    }
+
+    void rehash(size_t capacity)
+    {
+        int8_t* oldControl = m_control;
+        value_type* oldSlots = m_slots;
+        const size_t oldCapacity = m_capacity;
+
+        m_capacity = capacity;
+        m_control = static_cast<int8_t*>(::operator new(capacity, std::align_val_t(ControlGroup::Width)));
+        m_slots = std::allocator<value_type>().allocate(capacity);
+        resetControl();
+
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldControl[i] >= 0) {
+                const size_t hash = hashOf(oldSlots[i].first);
+                const size_t index = findInsertIndex(hash);
+                new (m_slots + index) value_type(std::move(oldSlots[i]));
+                m_control[index] = shortHash(hash);
+                oldSlots[i].~value_type();
+                --m_growthLeft;
+                ++m_size;
+            }
+        }
+
+        if (oldCapacity != 0) {
+            ::operator delete(oldControl, std::align_val_t(ControlGroup::Width));
+            std::allocator<value_type>().deallocate(oldSlots, oldCapacity);
+        }
+    }
+
+    void resetControl()
+    {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            m_control[i] = ControlEmpty;
+        }
+        m_size = 0;
+        m_growthLeft = growthFor(m_capacity);
+    }
+
+    void destroyAll()
+    {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (m_control[i] >= 0) {
+                m_slots[i].~value_type();
+            }
+        }
+    }
+
+    void deallocate()
+    {
+        if (m_capacity != 0) {
+            ::operator delete(m_control, std::align_val_t(ControlGroup::Width));
+            std::allocator<value_type>().deallocate(m_slots, m_capacity);
+        }
+        m_control = nullptr;
+        m_slots = nullptr;
+        m_capacity = 0;
+    }
+
+private:
+    int8_t* m_control = nullptr;
+    value_type* m_slots = nullptr;
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+    size_t m_growthLeft = 0;
+    bool m_fixed = false;
+    Hash m_hash;
+    Equal m_equal;
+};
@@ -0,0 +1,15 @@
+#include "Hash.hpp"
+#include <random>
+
+//
+// INFO: Seed comes straight from 'std::random_device', drawing it from
+// 'ServerRandom' would shift stream seeded by cluster
+//
+uint64_t hashSeed()
+{
+    static const uint64_t s_seed = [] {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32u) | device();
+    }();
+    return s_seed;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ConstexprRandom.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//
+// INFO: Per-process seed drawn from 'std::random_device' on first use, hash values
+// differ between processes, so attacker can't precompute colliding keys.
+// Don't persist or send seeded hashes, pass explicit seed when you need that
+//
+uint64_t hashSeed();
+
+inline uint64_t multiplyFold(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    const auto product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64u);
+#else
+    const uint64_t aLow = a & 0xffffffffu;
+    const uint64_t aHigh = a >> 32u;
+    const uint64_t bLow = b & 0xffffffffu;
+    const uint64_t bHigh = b >> 32u;
+
+    const uint64_t lowLow = aLow * bLow;
+    const uint64_t lowHigh = aLow * bHigh;
+    const uint64_t middle = (lowLow >> 32u) + (lowHigh & 0xffffffffu) + aHigh * bLow;
+
+    const uint64_t low = (middle << 32u) | (lowLow & 0xffffffffu);
+    const uint64_t high = aHigh * bHigh + (lowHigh >> 32u) + (middle >> 32u);
+    return low ^ high;
+#endif
+}
+
+//
+// INFO: Full avalanche, every input bit affects every output bit, so high bits
+// (table index, HyperLogLog register) and low bits are independent
+//
+inline uint64_t mixHash(uint64_t value, uint64_t seed)
+{
+    return SplitMix64::mix(value ^ seed ^ 0xa0761d6478bd642full);
+}
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+
+    uint64_t hash = seed ^ 0x8ebc6af09c88c6e3ull;
+    size_t left = size;
+    for (; left >= 8; left -= 8, bytes += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        hash = multiplyFold(hash ^ word, 0x589965cc75374cc3ull);
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes, left);
+    hash = multiplyFold(hash ^ tail, 0x1d8e4e27c47d124full);
+
+    return SplitMix64::mix(hash ^ static_cast<uint64_t>(size));
+}
+
+//
+// INFO: Hash with explicit seed, same value and seed give same hash in every
+// process, use it for persisted or exchanged hashes e.g. sketches
+//
+template <typename T>
+uint64_t hashValue(const T& value, uint64_t seed)
+{
+    if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+        const std::string_view bytes = value;
+        return hashBytes(bytes.data(), bytes.size(), seed);
+    } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        return mixHash(bits, seed);
+    } else {
+        return mixHash(static_cast<uint64_t>(std::hash<T> {}(value)), seed);
+    }
+}
+
+template <typename T>
+struct SeededHash {
+    uint64_t seed = hashSeed();
+
+    size_t operator()(const T& value) const
+    {
+        return static_cast<size_t>(hashValue(value, seed));
+    }
+};
+
+//
+// INFO: Strings are hashed byte by byte with seed, 'std::hash' collisions
+// would be seed independent. Transparent, so maps keyed by 'std::string'
+// can be searched with 'std::string_view' or literals without allocation
+//
+struct SeededStringHash {
+    using is_transparent = void;
+
+    uint64_t seed = hashSeed();
+
+    size_t operator()(std::string_view value) const
+    {
+        return static_cast<size_t>(hashBytes(value.data(), value.size(), seed));
+    }
+};
+
+template <>
+struct SeededHash<std::string> : SeededStringHash {
+};
+
+template <>
+struct SeededHash<std::string_view> : SeededStringHash {
+};
@@ -0,0 +1,432 @@
+#include "MinHash.hpp"
+#include "Assertions.hpp"
+#include "ConstexprRandom.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint32_t MinHashMagic = 0x484d4c41; // "ALMH"
+constexpr uint32_t MinHashVersion = 2;
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "MinHash file is written and mapped in place, little-endian host required.");
+#endif
+
+//
+// INFO: File layout, all fields little-endian:
+// [FileHeader][signatures: count * size uint32, padded to 8][bands * count BandEntry sorted by key]
+//
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seed;
+    uint32_t size;
+    uint32_t mode;
+    uint32_t bands;
+    uint32_t rows;
+    uint64_t count;
+};
+
+struct FileBandEntry {
+    uint64_t key;
+    uint32_t id;
+    uint32_t padding;
+};
+
+static_assert(sizeof(FileHeader) == 40, "File header must be packed.");
+static_assert(sizeof(FileBandEntry) == 16, "Band entry must be packed.");
+
+size_t alignedTo8(size_t bytes)
+{
+    return (bytes + 7) & ~size_t(7);
+}
+
+uint64_t bandKey(const uint32_t* signature, size_t band, size_t rows)
+{
+    return hashBytes(signature + band * rows, rows * sizeof(uint32_t), band);
+}
+
+size_t threadCount(size_t requested)
+{
+    const size_t hardware = std::max<unsigned>(1, std::thread::hardware_concurrency());
+    return requested == 0 ? hardware : requested;
+}
+
+template <typename F>
+void parallelFor(size_t count, size_t threads, F&& fn)
+{
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&fn, t, threads, count] {
+            for (size_t i = t; i < count; i += threads) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+template <typename Signatures>
+std::vector<std::pair<uint32_t, double>> filterBySimilarity(const std::vector<uint32_t>& candidates,
+    const uint32_t* signature,
+    size_t size,
+    double minSimilarity,
+    Signatures&& signatureOf)
+{
+    std::vector<std::pair<uint32_t, double>> result;
+    for (uint32_t id : candidates) {
+        const double similarity = MinHash::similarity(signature, signatureOf(id), size);
+        if (similarity >= minSimilarity) {
+            result.emplace_back(id, similarity);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    });
+    return result;
+}
+}
+
+//
+// MinHash
+//
+
+MinHash::MinHash(size_t size, MinHashMode mode, uint64_t seed)
+    : m_size(size)
+    , m_mode(mode)
+    , m_seed(seed)
+{
+    ally_assert(size > 0);
+
+    if (mode == MinHashMode::Permutations) {
+        SplitMix64 generator(seed);
+        m_multipliers.resize(size);
+        m_increments.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            m_multipliers[i] = ConstexprRandom::uniform<uint64_t>(generator) | 1u;
+            m_increments[i] = ConstexprRandom::uniform<uint64_t>(generator);
+        }
+    }
+}
+
+void MinHash::signatureOfHashes(const uint64_t* hashes, size_t count, uint32_t* out) const
+{
+    if (m_mode == MinHashMode::Permutations) {
+        permutationSignature(hashes, count, out);
+    } else {
+        onePermutationSignature(hashes, count, out);
+    }
+}
+
+void MinHash::permutationSignature(const uint64_t* hashes, size_t count, uint32_t* out) const
+{
+    std::fill(out, out + m_size, std::numeric_limits<uint32_t>::max());
+
+    const uint64_t* multipliers = m_multipliers.data();
+    const uint64_t* increments = m_increments.data();
+
+    for (size_t element = 0; element < count; ++element) {
+        const uint64_t x = hashes[element];
+
+        //
+        // INFO: Keep this loop branchless, compiler turns it into vector
+        // multiply-add and unsigned min over 'size' lanes
+        //
+        for (size_t i = 0; i < m_size; ++i) {
+            const auto value = static_cast<uint32_t>((multipliers[i] * x + increments[i]) >> 32u);
+            out[i] = std::min(out[i], value);
+        }
+    }
+}
+
+void MinHash::onePermutationSignature(const uint64_t* hashes, size_t count, uint32_t* out) const
+{
+    constexpr uint32_t EmptyBin = std::numeric_limits<uint32_t>::max();
+    std::fill(out, out + m_size, EmptyBin);
+
+    for (size_t element = 0; element < count; ++element) {
+        const uint64_t hash = hashes[element];
+        const auto bin = static_cast<size_t>(((hash >> 32u) * m_size) >> 32u);
+        out[bin] = std::min(out[bin], static_cast<uint32_t>(hash));
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    //
+    // INFO: Optimal densification (Shrivastava 2017), empty bin borrows value
+    // of a non-empty bin chosen by hash of (bin, attempt), same for every set
+    //
+    std::vector<uint32_t> filled(out, out + m_size);
+    for (size_t bin = 0; bin < m_size; ++bin) {
+        if (filled[bin] != EmptyBin) {
+            continue;
+        }
+
+        for (uint64_t attempt = 1;; ++attempt) {
+            const auto donor = static_cast<size_t>(mixHash(bin * 0x9e3779b97f4a7c15ull + attempt, m_seed) % m_size);
+            if (filled[donor] != EmptyBin) {
+                out[bin] = filled[donor];
+                break;
+            }
+        }
+    }
+}
+
+double MinHash::similarity(const uint32_t* a, const uint32_t* b, size_t size)
+{
+    size_t equal = 0;
+    for (size_t i = 0; i < size; ++i) {
+        equal += a[i] == b[i] ? 1 : 0;
+    }
+    return static_cast<double>(equal) / static_cast<double>(size);
+}
+
+//
+// MinHashIndex
+//
+
+MinHashIndex::MinHashIndex(const MinHash& minHash, size_t bands, size_t rows)
+    : m_minHash(minHash)
+    , m_bands(bands)
+    , m_rows(rows)
+    , m_tables(bands)
+{
+    ally_assert(bands * rows <= minHash.size());
+}
+
+uint32_t MinHashIndex::add(const uint32_t* signature)
+{
+    const auto id = static_cast<uint32_t>(m_count++);
+    m_signatures.insert(m_signatures.end(), signature, signature + m_minHash.size());
+    insertBands(id, 0, 1);
+    return id;
+}
+
+void MinHashIndex::addBatch(const std::vector<std::vector<uint64_t>>& sets, size_t threads)
+{
+    threads = threadCount(threads);
+
+    const size_t size = m_minHash.size();
+    const size_t first = m_count;
+    m_signatures.resize((first + sets.size()) * size);
+    m_count += sets.size();
+
+    parallelFor(sets.size(), threads, [&](size_t i) {
+        m_minHash.signatureOfHashes(sets[i].data(), sets[i].size(), m_signatures.data() + (first + i) * size);
+    });
+
+    parallelFor(m_bands, threads, [&](size_t band) {
+        for (size_t i = 0; i < sets.size(); ++i) {
+            insertBands(static_cast<uint32_t>(first + i), band, m_bands);
+        }
+    });
+}
+
+void MinHashIndex::insertBands(uint32_t id, size_t firstBand, size_t bandStep)
+{
+    const uint32_t* signature = signatureOf(id);
+    for (size_t band = firstBand; band < m_bands; band += bandStep) {
+        m_tables[band][bandKey(signature, band, m_rows)].push_back(id);
+    }
+}
+
+std::vector<uint32_t> MinHashIndex::candidates(const uint32_t* signature) const
+{
+    std::vector<uint32_t> result;
+    for (size_t band = 0; band < m_bands; ++band) {
+        auto it = m_tables[band].find(bandKey(signature, band, m_rows));
+        if (it != m_tables[band].end()) {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<std::pair<uint32_t, double>> MinHashIndex::query(const uint32_t* signature, double minSimilarity) const
+{
+    return filterBySimilarity(candidates(signature), signature, m_minHash.size(), minSimilarity,
+        [this](uint32_t id) { return signatureOf(id); });
+}
+
+bool MinHashIndex::save(const std::string& path) const
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    FileHeader header = {};
+    header.magic = MinHashMagic;
+    header.version = MinHashVersion;
+    header.seed = m_minHash.seed();
+    header.size = static_cast<uint32_t>(m_minHash.size());
+    header.mode = static_cast<uint32_t>(m_minHash.mode());
+    header.bands = static_cast<uint32_t>(m_bands);
+    header.rows = static_cast<uint32_t>(m_rows);
+    header.count = m_count;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    const size_t signatureBytes = m_signatures.size() * sizeof(uint32_t);
+    const uint64_t zero = 0;
+    ok = ok && std::fwrite(m_signatures.data(), 1, signatureBytes, file) == signatureBytes;
+    ok = ok && std::fwrite(&zero, 1, alignedTo8(signatureBytes) - signatureBytes, file) == alignedTo8(signatureBytes) - signatureBytes;
+
+    std::vector<FileBandEntry> entries;
+    for (size_t band = 0; band < m_bands && ok; ++band) {
+        entries.clear();
+        for (const auto& bucket : m_tables[band]) {
+            for (uint32_t id : bucket.second) {
+                entries.push_back({ bucket.first, id, 0 });
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const FileBandEntry& a, const FileBandEntry& b) {
+            return a.key < b.key || (a.key == b.key && a.id < b.id);
+        });
+        ok = std::fwrite(entries.data(), sizeof(FileBandEntry), entries.size(), file) == entries.size();
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+//
+// MappedMinHashIndex
+//
+
+struct MappedMinHashIndex::BandEntry : FileBandEntry {
+};
+
+MappedMinHashIndex::MappedMinHashIndex(const std::string& path)
+{
+    static_assert(sizeof(BandEntry) == sizeof(FileBandEntry), "Band entry must match file layout.");
+
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        return;
+    }
+
+    const auto fileSize = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    //
+    // INFO: Count is bounded by what fits into file before every product,
+    // so neither signature nor entry bytes can overflow
+    //
+    const uint64_t payloadBytes = fileSize - sizeof(FileHeader);
+    bool valid = header.magic == MinHashMagic && header.version == MinHashVersion
+        && header.size > 0 && static_cast<uint64_t>(header.bands) * header.rows <= header.size
+        && header.mode <= static_cast<uint32_t>(MinHashMode::OnePermutation)
+        && header.count <= payloadBytes / (static_cast<uint64_t>(header.size) * sizeof(uint32_t));
+
+    const uint64_t signatureBytes = valid ? alignedTo8(static_cast<size_t>(header.count) * header.size * sizeof(uint32_t)) : 0;
+    valid = valid && signatureBytes <= payloadBytes
+        && (header.bands == 0 || header.count <= (payloadBytes - signatureBytes) / (static_cast<uint64_t>(header.bands) * sizeof(FileBandEntry)));
+
+    const uint64_t entryBytes = valid ? header.count * header.bands * sizeof(FileBandEntry) : 0;
+    valid = valid && payloadBytes == signatureBytes + entryBytes;
+
+    if (!valid) {
+        munmap(data, fileSize);
+        return;
+    }
+
+    m_minHash = MinHash(header.size, static_cast<MinHashMode>(header.mode), header.seed);
+    m_bands = header.bands;
+    m_rows = header.rows;
+    m_count = static_cast<size_t>(header.count);
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    m_signatures = reinterpret_cast<const uint32_t*>(bytes + sizeof(FileHeader));
+    m_entries = reinterpret_cast<const BandEntry*>(bytes + sizeof(FileHeader) + signatureBytes);
+    m_data = data;
+    m_dataSize = fileSize;
+#else
+    static_cast<void>(path);
+#endif
+}
+
+MappedMinHashIndex::~MappedMinHashIndex()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (m_data) {
+        munmap(m_data, m_dataSize);
+    }
+#endif
+}
+
+std::vector<uint32_t> MappedMinHashIndex::candidates(const uint32_t* signature) const
+{
+    std::vector<uint32_t> result;
+    for (size_t band = 0; band < m_bands; ++band) {
+        const BandEntry* first = m_entries + band * m_count;
+        const BandEntry* last = first + m_count;
+        const uint64_t key = bandKey(signature, band, m_rows);
+
+        auto range = std::equal_range(first, last, key, [](const auto& a, const auto& b) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (std::is_same<A, uint64_t>::value) {
+                return a < b.key;
+            } else {
+                return a.key < b;
+            }
+        });
+
+        for (const BandEntry* entry = range.first; entry != range.second; ++entry) {
+            if (entry->id < m_count) {
+                result.push_back(entry->id);
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<std::pair<uint32_t, double>> MappedMinHashIndex::query(const uint32_t* signature, double minSimilarity) const
+{
+    return filterBySimilarity(candidates(signature), signature, m_minHash.size(), minSimilarity,
+        [this](uint32_t id) { return signatureOf(id); });
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "FlatHashMap.hpp"
+#include "Hash.hpp"
+#include "Sketches.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// INFO: MinHash signatures estimate Jaccard similarity of sets. Element hashes
+// are 64-bit ('hashValue(item, seed)'), signature values are 32-bit.
+//
+// 'Permutations' mode applies k hash functions 'a * x + b' with parameters drawn
+// by 'ConstexprRandom' from 'SplitMix64' seeded by 'seed', same on every platform,
+// so saved signatures stay comparable. Inner loop over k has no branches and is
+// vectorized. 'OnePermutation' mode hashes every element once and splits hash
+// range into k bins, empty bins are filled by optimal densification, it costs
+// O(n + k) instead of O(n * k)
+//
+enum class MinHashMode : uint32_t {
+    Permutations = 0,
+    OnePermutation = 1
+};
+
+class MinHash {
+public:
+    explicit MinHash(size_t size = 128, MinHashMode mode = MinHashMode::Permutations, uint64_t seed = sketchSeed("MinHash"));
+
+    size_t size() const { return m_size; }
+    MinHashMode mode() const { return m_mode; }
+    uint64_t seed() const { return m_seed; }
+
+    //
+    // INFO: Element hashes 'signature' is computed from, pass them to
+    // 'signatureOfHashes' or 'MinHashIndex::addBatch' to get the same values
+    //
+    template <typename C>
+    std::vector<uint64_t> hashesOf(const C& items) const
+    {
+        std::vector<uint64_t> hashes;
+        hashes.reserve(items.size());
+        for (const auto& item : items) {
+            hashes.push_back(hashValue(item, m_seed));
+        }
+        return hashes;
+    }
+
+    template <typename C>
+    std::vector<uint32_t> signature(const C& items) const
+    {
+        const std::vector<uint64_t> hashes = hashesOf(items);
+        std::vector<uint32_t> result(m_size);
+        signatureOfHashes(hashes.data(), hashes.size(), result.data());
+        return result;
+    }
+
+    //
+    // INFO: 'out' must have 'size()' values
+    //
+    void signatureOfHashes(const uint64_t* hashes, size_t count, uint32_t* out) const;
+
+    static double similarity(const uint32_t* a, const uint32_t* b, size_t size);
+
+private:
+    void permutationSignature(const uint64_t* hashes, size_t count, uint32_t* out) const;
+    void onePermutationSignature(const uint64_t* hashes, size_t count, uint32_t* out) const;
+
+private:
+    size_t m_size;
+    MinHashMode m_mode;
+    uint64_t m_seed;
+    std::vector<uint64_t> m_multipliers;
+    std::vector<uint64_t> m_increments;
+};
+
+//
+// INFO: LSH banding, signature is split into 'bands' of 'rows' values, sets
+// that share at least one band are candidates. Ids are dense and assigned
+// in insertion order
+//
+// Usage:
+//   MinHash minHash(128);
+//   MinHashIndex index(minHash, 32, 4);
+//   index.addItemBatch(playerDecks);
+//   auto similar = index.query(minHash.signature(deck).data(), 0.6);
+//   index.save("decks.minhash");
+//   MappedMinHashIndex mapped("decks.minhash");
+//
+class MinHashIndex {
+public:
+    MinHashIndex(const MinHash& minHash, size_t bands, size_t rows);
+
+    const MinHash& minHash() const { return m_minHash; }
+    size_t size() const { return m_count; }
+
+    uint32_t add(const uint32_t* signature);
+
+    //
+    // INFO: Signatures are computed in parallel, then band tables are filled
+    // in parallel, one band per task. Sets are containers of element hashes
+    //
+    void addBatch(const std::vector<std::vector<uint64_t>>& sets, size_t threads = 0);
+
+    //
+    // INFO: Sets are containers of items, hashed by 'MinHash::hashesOf',
+    // so ids match 'query(minHash.signature(items))'
+    //
+    template <typename C>
+    void addItemBatch(const std::vector<C>& sets, size_t threads = 0)
+    {
+        std::vector<std::vector<uint64_t>> hashes;
+        hashes.reserve(sets.size());
+        for (const auto& items : sets) {
+            hashes.push_back(m_minHash.hashesOf(items));
+        }
+        addBatch(hashes, threads);
+    }
+
+    std::vector<uint32_t> candidates(const uint32_t* signature) const;
+    std::vector<std::pair<uint32_t, double>> query(const uint32_t* signature, double minSimilarity) const;
+
+    const uint32_t* signatureOf(uint32_t id) const { return m_signatures.data() + static_cast<size_t>(id) * m_minHash.size(); }
+
+    bool save(const std::string& path) const;
+
+private:
+    void insertBands(uint32_t id, size_t firstBand, size_t bandStep);
+
+private:
+    MinHash m_minHash;
+    size_t m_bands;
+    size_t m_rows;
+    size_t m_count = 0;
+    std::vector<uint32_t> m_signatures;
+    std::vector<FlatHashMap<uint64_t, std::vector<uint32_t>>> m_tables;
+};
+
+//
+// INFO: Read-only index saved by 'MinHashIndex::save', file is memory-mapped
+// and queried in place, band tables are sorted arrays searched by key. File is
+// not byte swapped, so only little-endian hosts build it. Opening checks header
+// against file size, ids out of range are skipped, key order is trusted
+//
+class MappedMinHashIndex {
+public:
+    explicit MappedMinHashIndex(const std::string& path);
+    ~MappedMinHashIndex();
+
+    MappedMinHashIndex(const MappedMinHashIndex&) = delete;
+    MappedMinHashIndex& operator=(const MappedMinHashIndex&) = delete;
+
+    bool isValid() const { return m_data != nullptr; }
+
+    const MinHash& minHash() const { return m_minHash; }
+    size_t size() const { return m_count; }
+
+    std::vector<uint32_t> candidates(const uint32_t* signature) const;
+    std::vector<std::pair<uint32_t, double>> query(const uint32_t* signature, double minSimilarity) const;
+
+    const uint32_t* signatureOf(uint32_t id) const { return m_signatures + static_cast<size_t>(id) * m_minHash.size(); }
+
+private:
+    struct BandEntry;
+
+private:
+    MinHash m_minHash;
+    size_t m_bands = 0;
+    size_t m_rows = 0;
+    size_t m_count = 0;
+    const uint32_t* m_signatures = nullptr;
+    const BandEntry* m_entries = nullptr;
+    void* m_data = nullptr;
+    size_t m_dataSize = 0;
+};
@@ -0,0 +1,220 @@
+#include "NoiseProcess.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+//
+// INFO: Natural logarithm of 'x' in (0, 1]. Exponent and mantissa are split
+// by integer ops so that mantissa 'm' is in [sqrt(2) / 2, sqrt(2)), then
+// 'log(m) = 2 * atanh((m - 1) / (m + 1))' by series, relative error is below 1e-6
+//
+inline float logUnit(float x)
+{
+    constexpr uint32_t HalfSqrtTwo = 0x3f3504f3u;
+
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits += 0x3f800000u - HalfSqrtTwo;
+
+    const auto exponent = static_cast<float>(static_cast<int32_t>(bits >> 23u) - 127);
+    const uint32_t mantissaBits = (bits & 0x7fffffu) + HalfSqrtTwo;
+
+    float mantissa;
+    std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+
+    const float t = (mantissa - 1.f) / (mantissa + 1.f);
+    const float t2 = t * t;
+    const float series = t * (2.f + t2 * (2.f / 3.f + t2 * (2.f / 5.f + t2 * (2.f / 7.f))));
+    return exponent * 0.6931471805599453f + series;
+}
+
+//
+// INFO: 'std::sqrt' may set errno, that is a branch in loop body and blocks
+// vectorization. Inverse square root from bits with three Newton steps is
+// exact to float precision and gives 0 for 0
+//
+inline float sqrtNonNegative(float x)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f3759dfu - (bits >> 1u);
+
+    float inverse;
+    std::memcpy(&inverse, &bits, sizeof(inverse));
+    const float half = 0.5f * x;
+    inverse *= 1.5f - half * inverse * inverse;
+    inverse *= 1.5f - half * inverse * inverse;
+    inverse *= 1.5f - half * inverse * inverse;
+    return x * inverse;
+}
+
+struct SinCos {
+    float sin;
+    float cos;
+};
+
+//
+// INFO: Sine and cosine of 'turn * 2 * pi' for 'turn' in [0, 1]. Turn is split
+// into quadrant and angle in [-pi / 4, pi / 4], where Taylor polynomials
+// are accurate to 5e-7, quadrant rotates result by arithmetic on its bits
+//
+inline SinCos sinCosTurn(float turn)
+{
+    constexpr float TwoPi = 6.283185307179586f;
+
+    const auto quadrant = static_cast<int32_t>(turn * 4.f + 0.5f);
+    const float angle = (turn - static_cast<float>(quadrant) * 0.25f) * TwoPi;
+    const float a2 = angle * angle;
+
+    const float sine = angle * (1.f + a2 * (-1.f / 6.f + a2 * (1.f / 120.f + a2 * (-1.f / 5040.f))));
+    const float cosine = 1.f + a2 * (-0.5f + a2 * (1.f / 24.f + a2 * (-1.f / 720.f + a2 * (1.f / 40320.f))));
+
+    //
+    // INFO: Quadrants 1 and 3 swap sine and cosine, sine is negative in
+    // quadrants 2 and 3, cosine in 1 and 2
+    //
+    const int32_t rotation = quadrant & 3;
+    const auto swapped = static_cast<float>(rotation & 1);
+    const float sinSign = 1.f - static_cast<float>(rotation & 2);
+    const float cosSign = 1.f - static_cast<float>((rotation + 1) & 2);
+    const float difference = cosine - sine;
+    return { sinSign * (sine + swapped * difference), cosSign * (cosine - swapped * difference) };
+}
+}
+
+NoiseProcesses::NoiseProcesses(uint64_t seed)
+    : m_seed(seed)
+{
+}
+
+uint32_t NoiseProcesses::addOrnsteinUhlenbeck(float mean, float reversion, float volatility, float initial)
+{
+    return add(Kind::OrnsteinUhlenbeck, mean, reversion, volatility, -Unbounded, Unbounded, initial);
+}
+
+uint32_t NoiseProcesses::addAutoRegressive(float phi, float sigma, float constant, float initial)
+{
+    return add(Kind::AutoRegressive, phi, sigma, constant, -Unbounded, Unbounded, initial);
+}
+
+uint32_t NoiseProcesses::addRandomWalk(float sigma, float low, float high, float initial)
+{
+    return add(Kind::RandomWalk, sigma, 0.f, 0.f, low, high, initial);
+}
+
+uint32_t NoiseProcesses::add(Kind kind, float first, float second, float third, float low, float high, float initial)
+{
+    const auto id = static_cast<uint32_t>(m_values.size());
+
+    m_values.push_back(initial);
+    m_a.push_back(0.f);
+    m_b.push_back(0.f);
+    m_c.push_back(0.f);
+    m_low.push_back(low);
+    m_high.push_back(high);
+    if (id % 2 == 0) {
+        m_streams.push_back(mixHash(id / 2, m_seed));
+    }
+
+    m_kinds.push_back(kind);
+    m_first.push_back(first);
+    m_second.push_back(second);
+    m_third.push_back(third);
+
+    m_noise.resize(m_streams.size() * 2);
+    m_dirty = true;
+    return id;
+}
+
+void NoiseProcesses::step(float dt)
+{
+    if (m_dirty || dt != m_dt) {
+        updateCoefficients(dt);
+    }
+
+    gaussians();
+
+    const size_t count = m_values.size();
+    float* values = m_values.data();
+    const float* a = m_a.data();
+    const float* b = m_b.data();
+    const float* c = m_c.data();
+    const float* low = m_low.data();
+    const float* high = m_high.data();
+    const float* noise = m_noise.data();
+
+    for (size_t i = 0; i < count; ++i) {
+        float x = a[i] * values[i] + b[i] + c[i] * noise[i];
+
+        //
+        // INFO: Reflect from bounds, then clamp overshoot of more than range width
+        //
+        x = std::min(std::max(x, 2.f * low[i] - x), 2.f * high[i] - x);
+        values[i] = std::min(std::max(x, low[i]), high[i]);
+    }
+
+    ++m_step;
+}
+
+void NoiseProcesses::updateCoefficients(float dt)
+{
+    for (size_t i = 0; i < m_values.size(); ++i) {
+        switch (m_kinds[i]) {
+        case Kind::OrnsteinUhlenbeck: {
+            const float mean = m_first[i];
+            const float reversion = m_second[i];
+            const float volatility = m_third[i];
+
+            const float decay = std::exp(-reversion * dt);
+            m_a[i] = decay;
+            m_b[i] = mean * (1.f - decay);
+            m_c[i] = reversion > 0.f
+                ? volatility * std::sqrt((1.f - decay * decay) / (2.f * reversion))
+                : volatility * std::sqrt(dt);
+            break;
+        }
+        case Kind::AutoRegressive:
+            m_a[i] = m_first[i];
+            m_b[i] = m_third[i];
+            m_c[i] = m_second[i];
+            break;
+        case Kind::RandomWalk:
+            m_a[i] = 1.f;
+            m_b[i] = 0.f;
+            m_c[i] = m_first[i] * std::sqrt(dt);
+            break;
+        }
+    }
+
+    m_dt = dt;
+    m_dirty = false;
+}
+
+void NoiseProcesses::gaussians()
+{
+    constexpr float Unit = 1.f / 16777216.f;
+
+    const size_t pairs = m_streams.size();
+    const uint64_t step = m_step;
+    const uint64_t* streams = m_streams.data();
+    float* noise = m_noise.data();
+
+    //
+    // INFO: Box-Muller from one 64-bit hash gives two normals, for processes
+    // '2 * k' and '2 * k + 1'. 'u1' is in (0, 1], logarithm is finite,
+    // 'abs' drops rounding error above zero. Body is branch-free arithmetic
+    // without library calls, so the loop is vectorized, 64-bit hash included
+    //
+    for (size_t i = 0; i < pairs; ++i) {
+        const uint64_t bits = mixHash(step, streams[i]);
+        const float u1 = static_cast<float>(static_cast<uint32_t>(bits >> 40u) + 1u) * Unit;
+        const float u2 = static_cast<float>(static_cast<uint32_t>(bits) & 0xffffffu) * Unit;
+
+        const float radius = sqrtNonNegative(std::abs(-2.f * logUnit(u1)));
+        const SinCos angle = sinCosTurn(u2);
+        noise[2 * i] = radius * angle.cos;
+        noise[2 * i + 1] = radius * angle.sin;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//
+// INFO: Time-correlated noise for steering, camera shake, jitter emulation.
+// Thousands of processes are stepped by one call, state is struct-of-arrays
+// and every process is one linear update 'x = a * x + b + c * n' with bounds,
+// so step is two flat loops, both vectorized at -O3.
+//
+// Gaussian 'n' of process 'id' at step 'k' is computed by Box-Muller from hash
+// of (seed, id / 2, k), one hash gives normals of two neighbour processes.
+// Logarithm, square root and sine are branch-free polynomials, not libm calls,
+// so Box-Muller loop vectorizes too and its error is below 1e-6.
+// Path of process depends only on seed, its id and step number, not on other
+// processes or order of updates
+//
+// 'OrnsteinUhlenbeck' - reverts to 'mean' with rate 'reversion', exact discretization
+// 'AutoRegressive' - AR(1) 'x = constant + phi * x + sigma * n', one step per call
+// 'RandomWalk' - 'x += sigma * sqrt(dt) * n', reflected from [low, high]
+//
+// Usage:
+//   NoiseProcesses shake(seed);
+//   auto x = shake.addOrnsteinUhlenbeck(0.f, 8.f, 0.5f);
+//   shake.step(dt);
+//   camera.offset.x = shake.value(x);
+//
+class NoiseProcesses {
+public:
+    static constexpr float Unbounded = std::numeric_limits<float>::infinity();
+
+    explicit NoiseProcesses(uint64_t seed = 0x6a09e667f3bcc909ull);
+
+    uint32_t addOrnsteinUhlenbeck(float mean, float reversion, float volatility, float initial = 0.f);
+    uint32_t addAutoRegressive(float phi, float sigma, float constant = 0.f, float initial = 0.f);
+    uint32_t addRandomWalk(float sigma, float low = -Unbounded, float high = Unbounded, float initial = 0.f);
+
+    void step(float dt);
+
+    size_t size() const { return m_values.size(); }
+    float value(uint32_t id) const { return m_values[id]; }
+    const float* values() const { return m_values.data(); }
+    uint64_t stepCount() const { return m_step; }
+
+    void setValue(uint32_t id, float value) { m_values[id] = value; }
+
+private:
+    enum class Kind : uint8_t {
+        OrnsteinUhlenbeck,
+        AutoRegressive,
+        RandomWalk
+    };
+
+    uint32_t add(Kind kind, float first, float second, float third, float low, float high, float initial);
+    void updateCoefficients(float dt);
+    void gaussians();
+
+private:
+    uint64_t m_seed;
+    uint64_t m_step = 0;
+    float m_dt = 0.f;
+    bool m_dirty = true;
+
+    std::vector<float> m_values;
+    std::vector<float> m_a;
+    std::vector<float> m_b;
+    std::vector<float> m_c;
+    std::vector<float> m_low;
+    std::vector<float> m_high;
+    std::vector<uint64_t> m_streams;
+
+    std::vector<Kind> m_kinds;
+    std::vector<float> m_first;
+    std::vector<float> m_second;
+    std::vector<float> m_third;
+
+    std::vector<float> m_noise;
+};
@@ -0,0 +1,183 @@
+#include "PerfCounters.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+PerfSample& PerfSample::operator+=(const PerfSample& other)
+{
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cacheMisses += other.cacheMisses;
+    branchMisses += other.branchMisses;
+    return *this;
+}
+
+PerfSample& PerfSample::operator-=(const PerfSample& other)
+{
+    //
+    // INFO: Scaled values of multiplexed counters are estimations,
+    // they can go slightly backwards, clamp at zero
+    //
+    auto minus = [](uint64_t a, uint64_t b) { return a > b ? a - b : 0; };
+    cycles = minus(cycles, other.cycles);
+    instructions = minus(instructions, other.instructions);
+    cacheMisses = minus(cacheMisses, other.cacheMisses);
+    branchMisses = minus(branchMisses, other.branchMisses);
+    return *this;
+}
+
+double PerfSample::instructionsPerCycle() const
+{
+    return cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles);
+}
+
+#if defined(__linux__)
+
+namespace {
+int openCounter(uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    //
+    // pid == 0, cpu == -1: calling thread on any cpu
+    //
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+}
+
+PerfCounters::PerfCounters()
+{
+    const uint64_t configs[CounterCount] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    //
+    // INFO: Any counter can be missing (VM, container, perf_event_paranoid),
+    // first one that opens becomes group leader, missing ones read as zero
+    //
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        const int fd = openCounter(configs[counter], m_groupFd);
+        if (fd == -1) {
+            continue;
+        }
+
+        if (m_groupFd == -1) {
+            m_groupFd = fd;
+        }
+
+        m_fds[counter] = fd;
+        m_slots[counter] = m_openedCount++;
+    }
+
+    if (m_groupFd != -1) {
+        ioctl(m_groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : m_fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+PerfCounters::RawValues PerfCounters::readRaw() const
+{
+    RawValues raw;
+    if (m_groupFd == -1) {
+        return raw;
+    }
+
+    //
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+    //
+    uint64_t buffer[3 + CounterCount] = {};
+    const ssize_t bytes = ::read(m_groupFd, buffer, sizeof(buffer));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+        return raw;
+    }
+
+    raw.timeEnabled = buffer[1];
+    raw.timeRunning = buffer[2];
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        if (m_slots[counter] != -1) {
+            raw.values[counter] = buffer[3 + m_slots[counter]];
+        }
+    }
+    return raw;
+}
+
+#else
+
+PerfCounters::PerfCounters() = default;
+PerfCounters::~PerfCounters() = default;
+
+PerfCounters::RawValues PerfCounters::readRaw() const
+{
+    return {};
+}
+
+#endif
+
+PerfCounters& PerfCounters::thisThread()
+{
+    static thread_local PerfCounters s_counters;
+    return s_counters;
+}
+
+bool PerfCounters::isAvailable() const
+{
+    return m_groupFd != -1;
+}
+
+PerfSample PerfCounters::read() const
+{
+    const RawValues raw = readRaw();
+
+    auto scaled = [&raw](uint64_t value) {
+        if (raw.timeRunning == 0 || raw.timeRunning == raw.timeEnabled) {
+            return value;
+        }
+        return static_cast<uint64_t>(static_cast<double>(value) * static_cast<double>(raw.timeEnabled) / static_cast<double>(raw.timeRunning));
+    };
+
+    PerfSample sample;
+    sample.cycles = scaled(raw.values[Cycles]);
+    sample.instructions = scaled(raw.values[Instructions]);
+    sample.cacheMisses = scaled(raw.values[CacheMisses]);
+    sample.branchMisses = scaled(raw.values[BranchMisses]);
+    return sample;
+}
+
+PerfScope::PerfScope(PerfSample& accumulator, PerfCounters& counters)
+    : m_accumulator(accumulator)
+    , m_counters(counters)
+    , m_start(counters.read())
+{
+}
+
+PerfScope::~PerfScope()
+{
+    PerfSample elapsed = m_counters.read();
+    elapsed -= m_start;
+    m_accumulator += elapsed;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// INFO: Hardware counters of calling thread, values are already scaled
+// when kernel multiplexes counters. All zeroes when counters are unavailable
+//
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+
+    PerfSample& operator+=(const PerfSample& other);
+    PerfSample& operator-=(const PerfSample& other);
+
+    double instructionsPerCycle() const;
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    //
+    // INFO: Counters are opened once per thread on first use, keep using
+    // them from the same thread, they measure only thread that created them
+    //
+    static PerfCounters& thisThread();
+
+    bool isAvailable() const;
+
+    PerfSample read() const;
+
+private:
+    enum Counter {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        CounterCount
+    };
+
+    struct RawValues {
+        uint64_t values[CounterCount] = {};
+        uint64_t timeEnabled = 0;
+        uint64_t timeRunning = 0;
+    };
+
+    RawValues readRaw() const;
+
+private:
+    int m_groupFd = -1;
+    int m_fds[CounterCount] = { -1, -1, -1, -1 };
+    int m_slots[CounterCount] = { -1, -1, -1, -1 };
+    int m_openedCount = 0;
+};
+
+//
+// Usage: { PerfScope scope(m_zoneSample); hotPath(); } accumulates counters
+// of the region into 'm_zoneSample'
+//
+class PerfScope {
+public:
+    explicit PerfScope(PerfSample& accumulator, PerfCounters& counters = PerfCounters::thisThread());
+    ~PerfScope();
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfSample& m_accumulator;
+    PerfCounters& m_counters;
+    PerfSample m_start;
+};
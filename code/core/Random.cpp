@@ -1,6 +1,5 @@
 #include "Random.hpp"
 
-namespace BE {
 FastRandomTraits::GeneratorType& FastRandomTraits::generator()
 {
     static std::random_device s_device;
@@ -8,12 +7,40 @@ FastRandomTraits::GeneratorType& FastRandomTraits::generator()
     return s_fastGenerator;
 }
 
+namespace {
+uint64_t& serverSeed()
+{
+    static uint64_t s_seed = [] {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32u) | device();
+    }();
+    return s_seed;
+}
+}
+
 ServerRandomTraits::GeneratorType& ServerRandomTraits::generator()
 {
-    ally_assert(false, "user server seed please!");
-    static std::random_device s_device;
-    static ServerRandomTraits::GeneratorType s_fastGenerator(s_device());
+    static ServerRandomTraits::GeneratorType s_fastGenerator(serverSeed());
     return s_fastGenerator;
 }
 
+void ServerRandomTraits::setSeed(uint64_t seed)
+{
+    serverSeed() = seed;
+    generator().seed(seed);
+}
+
+uint64_t ServerRandomTraits::seed()
+{
+    return serverSeed();
+}
+
+ThreadRandomTraits::GeneratorType& ThreadRandomTraits::generator()
+{
+    thread_local ThreadRandomTraits::GeneratorType s_threadGenerator = [] {
+        std::random_device device;
+        const uint64_t seed = (static_cast<uint64_t>(device()) << 32u) | device();
+        return ThreadRandomTraits::GeneratorType(seed, device());
+    }();
+    return s_threadGenerator;
 }
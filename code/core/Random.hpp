@@ -2,12 +2,75 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <random>
+#include <type_traits>
+#include <vector>
 #include "Assertions.hpp"
+#include "ConstexprRandom.hpp"
+#include "RandomView.hpp"
 
 
+//
+// INFO: Per-entity probabilities prepared for 'RandomBase::forEachBernoulliHit',
+// entity with probability p goes to level k where 2^-(k+1) <= p < 2^-k,
+// p = 1 goes to level 0.
+// Level is sampled with geometric skips at 2^-k and hits are thinned by
+// p * 2^k >= 1/2, so cost is proportional to expected hit count. Probabilities
+// below 2^-(Levels - 1) are thinned in the last level
+//
+class BernoulliBuckets {
+public:
+    static constexpr int Levels = 32;
+
+    BernoulliBuckets() = default;
+
+    BernoulliBuckets(const float* probabilities, size_t count) { assign(probabilities, count); }
+
+    void assign(const float* probabilities, size_t count)
+    {
+        for (auto& level : m_levels) {
+            level.clear();
+        }
+        m_probabilities.assign(probabilities, probabilities + count);
+
+        for (size_t i = 0; i < count; ++i) {
+            const float p = probabilities[i];
+            if (!(p > 0.f)) {
+                continue;
+            }
+
+            int exponent = 0;
+            std::frexp(p, &exponent);
+            const int level = std::min(std::max(-exponent, 0), Levels - 1);
+            m_levels[level].push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    size_t size() const { return m_probabilities.size(); }
+    const std::vector<uint32_t>& level(int index) const { return m_levels[index]; }
+    float probability(uint32_t index) const { return m_probabilities[index]; }
+
+    static double levelProbability(int index) { return std::ldexp(1.0, -index); }
+
+private:
+    std::vector<uint32_t> m_levels[Levels];
+    std::vector<float> m_probabilities;
+};
+
+//
+// INFO: Element type of container, array or span
+//
+template <typename C>
+using RangeValueType = std::decay_t<decltype(*std::begin(std::declval<const C&>()))>;
+
+template <typename C, typename Projection>
+using IsWeightProjection = std::is_invocable<const Projection&, const RangeValueType<C>&>;
+
 template <typename RandomTraits>
 class RandomBase
 {
@@ -40,10 +103,23 @@ public:
     template <typename C>
     static typename C::value_type uniformFrom(const C& collection, Generator& generator = RandomTraits::generator());
 
-    template <typename C>
-    static typename C::value_type weightedFrom(const std::vector<float>& weights,
+    //
+    // INFO: Weights are any range of arithmetic values or projection of items,
+    // e.g. 'weightedFrom(items, &Item::weight)'. Range is scanned twice, nothing
+    // is copied. Integer weights are summed in 'uint64_t' and picked exactly,
+    // floating point weights are summed in double. Zero weights are never picked
+    //
+    template <typename W>
+    static size_t weightedIndex(const W& weights, Generator& generator = RandomTraits::generator());
+    template <typename C, typename Projection, typename = std::enable_if_t<IsWeightProjection<C, Projection>::value>>
+    static size_t weightedIndex(const C& collection, Projection projection, Generator& generator = RandomTraits::generator());
+
+    template <typename W, typename C, typename = std::enable_if_t<!IsWeightProjection<W, C>::value>>
+    static RangeValueType<C> weightedFrom(const W& weights,
         const C& collection,
         Generator& generator = RandomTraits::generator());
+    template <typename C, typename Projection, typename = std::enable_if_t<IsWeightProjection<C, Projection>::value>>
+    static RangeValueType<C> weightedFrom(const C& collection, Projection projection, Generator& generator = RandomTraits::generator());
 
     template <class RandomAccessIterator>
     static void shuffle(RandomAccessIterator first,
@@ -52,6 +128,85 @@ public:
 
     template <typename T>
     static T triangularf(T a, T b, T c, Generator& generator = RandomTraits::generator());
+
+    //
+    // INFO: Stratified samples in [0, 1), lower variance than independent 'uniformf'
+    // for integration and experiment design. Points are written to 'out', coordinates
+    // of one point are adjacent ('x, y' for 2D). With 'ThreadRandom' batches can be
+    // generated from worker threads
+    //
+    // 'jitteredf' - one sample in each of 'count' equal strata
+    // 'jittered2f' - one sample in each cell of 'width * height' grid
+    // 'jitteredNf' - one sample in each cell of 'strata^dimensions' grid
+    // 'latinHypercubef' - 'count' points, every dimension projection has one point per stratum
+    // 'correlatedMultiJittered2f' - Kensler 2013, jittered and latin hypercube at once
+    //
+    template <typename T>
+    static void jitteredf(T* out, size_t count, Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static void jittered2f(T* out, size_t width, size_t height, Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static void jitteredNf(T* out, size_t strata, size_t dimensions, Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static void latinHypercubef(T* out, size_t count, size_t dimensions, Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static void correlatedMultiJittered2f(T* out, size_t width, size_t height, Generator& generator = RandomTraits::generator());
+
+    //
+    // INFO: Bernoulli trial with probability 'p' for each index in [first, last),
+    // 'fn(index)' is called for hits in increasing order. Gaps between hits are
+    // geometric and drawn directly, so cost is O((last - first) * p) instead of
+    // one draw per index. Split range between threads and use 'ThreadRandom'
+    // for parallel tick. Batch version calls 'fn(const size_t* indices, size_t count)'
+    // with up to 'BernoulliBatchSize' indices
+    //
+    static constexpr size_t BernoulliBatchSize = 256;
+
+    template <typename F>
+    static void forEachBernoulliHit(size_t first, size_t last, double p, F&& fn, Generator& generator = RandomTraits::generator());
+    template <typename F>
+    static void forEachBernoulliBatch(size_t first, size_t last, double p, F&& fn, Generator& generator = RandomTraits::generator());
+
+    //
+    // INFO: Per-entity probabilities, hits are ordered by level, not by index
+    //
+    template <typename F>
+    static void forEachBernoulliHit(const BernoulliBuckets& buckets, F&& fn, Generator& generator = RandomTraits::generator());
+    template <typename F>
+    static void forEachBernoulliBatch(const BernoulliBuckets& buckets, F&& fn, Generator& generator = RandomTraits::generator());
+
+    //
+    // INFO: Views below are endless, values are generated in blocks, see 'RandomView'
+    //
+    template <typename T>
+    struct TriangularDistribution {
+        T a, b, c;
+        T operator()(Generator& generator) const { return RandomBase::triangularf(a, b, c, generator); }
+    };
+
+    template <typename T>
+    static RandomView<UniformDistribution<T>, Generator> uniformView(T from, T to, Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static RandomView<std::uniform_int_distribution<T>, Generator> probabilityView(Generator& generator = RandomTraits::generator());
+    template <typename T>
+    static RandomView<std::uniform_real_distribution<T>, Generator> probabilityfView(Generator& generator = RandomTraits::generator());
+
+    static RandomView<std::bernoulli_distribution, Generator> yesNoView(Generator& generator = RandomTraits::generator());
+
+    template <typename T>
+    static RandomView<std::normal_distribution<T>, Generator> normalfView(T mean, T stddev, Generator& generator = RandomTraits::generator());
+
+    template <typename T>
+    static RandomView<TriangularDistribution<T>, Generator> triangularfView(T a, T b, T c, Generator& generator = RandomTraits::generator());
+
+    template <typename C>
+    static RandomView<CollectionDistribution<C, std::uniform_int_distribution<size_t>>, Generator> uniformFromView(const C& collection,
+        Generator& generator = RandomTraits::generator());
+
+    template <typename C>
+    static RandomView<CollectionDistribution<C, std::discrete_distribution<size_t>>, Generator> weightedFromView(const std::vector<float>& weights,
+        const C& collection,
+        Generator& generator = RandomTraits::generator());
 };
 
 // implementation
@@ -75,6 +230,210 @@ T RandomBase<RandomTraits>::triangularf(T a, T b, T c, Generator& generator)
     }
 }
 
+template <typename RandomTraits>
+template <typename T>
+void RandomBase<RandomTraits>::jitteredf(T* out, size_t count, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+
+    std::uniform_real_distribution<T> jitter(static_cast<T>(0), static_cast<T>(1));
+    const T step = static_cast<T>(1) / static_cast<T>(count);
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = (static_cast<T>(i) + jitter(generator)) * step;
+    }
+}
+
+template <typename RandomTraits>
+template <typename T>
+void RandomBase<RandomTraits>::jittered2f(T* out, size_t width, size_t height, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+
+    std::uniform_real_distribution<T> jitter(static_cast<T>(0), static_cast<T>(1));
+    const T stepX = static_cast<T>(1) / static_cast<T>(width);
+    const T stepY = static_cast<T>(1) / static_cast<T>(height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x, out += 2) {
+            out[0] = (static_cast<T>(x) + jitter(generator)) * stepX;
+            out[1] = (static_cast<T>(y) + jitter(generator)) * stepY;
+        }
+    }
+}
+
+template <typename RandomTraits>
+template <typename T>
+void RandomBase<RandomTraits>::jitteredNf(T* out, size_t strata, size_t dimensions, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    ally_assert(strata > 0 && dimensions > 0);
+
+    size_t count = 1;
+    for (size_t d = 0; d < dimensions; ++d) {
+        ally_assert(count <= std::numeric_limits<size_t>::max() / strata, "too many strata");
+        count *= strata;
+    }
+
+    std::uniform_real_distribution<T> jitter(static_cast<T>(0), static_cast<T>(1));
+    const T step = static_cast<T>(1) / static_cast<T>(strata);
+    for (size_t i = 0; i < count; ++i) {
+        size_t cell = i;
+        for (size_t d = 0; d < dimensions; ++d, ++out) {
+            *out = (static_cast<T>(cell % strata) + jitter(generator)) * step;
+            cell /= strata;
+        }
+    }
+}
+
+template <typename RandomTraits>
+template <typename T>
+void RandomBase<RandomTraits>::latinHypercubef(T* out, size_t count, size_t dimensions, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+
+    std::uniform_real_distribution<T> jitter(static_cast<T>(0), static_cast<T>(1));
+    const T step = static_cast<T>(1) / static_cast<T>(count);
+
+    std::vector<size_t> strata(count);
+    for (size_t d = 0; d < dimensions; ++d) {
+        for (size_t i = 0; i < count; ++i) {
+            strata[i] = i;
+        }
+        RandomBase::shuffle(strata.begin(), strata.end(), generator);
+
+        for (size_t i = 0; i < count; ++i) {
+            out[i * dimensions + d] = (static_cast<T>(strata[i]) + jitter(generator)) * step;
+        }
+    }
+}
+
+template <typename RandomTraits>
+template <typename T>
+void RandomBase<RandomTraits>::correlatedMultiJittered2f(T* out, size_t width, size_t height, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+
+    //
+    // INFO: "Correlated Multi-Jittered Sampling", Kensler 2013. Cell (x, y) takes
+    // substratum of shuffled row in x and of shuffled column in y, one shuffle is
+    // shared by all rows and one by all columns, it keeps samples well spaced
+    //
+    std::vector<size_t> columns(width);
+    std::vector<size_t> rows(height);
+    for (size_t i = 0; i < width; ++i) {
+        columns[i] = i;
+    }
+    for (size_t i = 0; i < height; ++i) {
+        rows[i] = i;
+    }
+    RandomBase::shuffle(columns.begin(), columns.end(), generator);
+    RandomBase::shuffle(rows.begin(), rows.end(), generator);
+
+    std::uniform_real_distribution<T> jitter(static_cast<T>(0), static_cast<T>(1));
+    const auto w = static_cast<T>(width);
+    const auto h = static_cast<T>(height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x, out += 2) {
+            out[0] = (static_cast<T>(x) + (static_cast<T>(rows[y]) + jitter(generator)) / h) / w;
+            out[1] = (static_cast<T>(y) + (static_cast<T>(columns[x]) + jitter(generator)) / w) / h;
+        }
+    }
+}
+
+template <typename RandomTraits>
+template <typename F>
+void RandomBase<RandomTraits>::forEachBernoulliHit(size_t first, size_t last, double p, F&& fn, Generator& generator)
+{
+    if (!(p > 0.0) || first >= last) {
+        return;
+    }
+
+    if (p >= 1.0) {
+        for (size_t i = first; i < last; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    //
+    // INFO: Number of misses before hit is floor(log(u) / log(1 - p)),
+    // 'u' is in (0, 1], so logarithm is finite
+    //
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double logMiss = std::log1p(-p);
+
+    size_t index = first;
+    while (true) {
+        const double skip = std::floor(std::log(1.0 - uniform(generator)) / logMiss);
+        if (skip >= static_cast<double>(last - index)) {
+            return;
+        }
+
+        index += static_cast<size_t>(skip);
+        fn(index);
+        ++index;
+    }
+}
+
+template <typename RandomTraits>
+template <typename F>
+void RandomBase<RandomTraits>::forEachBernoulliBatch(size_t first, size_t last, double p, F&& fn, Generator& generator)
+{
+    size_t batch[BernoulliBatchSize];
+    size_t count = 0;
+
+    forEachBernoulliHit(first, last, p, [&](size_t index) {
+        batch[count++] = index;
+        if (count == BernoulliBatchSize) {
+            fn(static_cast<const size_t*>(batch), count);
+            count = 0;
+        }
+    }, generator);
+
+    if (count > 0) {
+        fn(static_cast<const size_t*>(batch), count);
+    }
+}
+
+template <typename RandomTraits>
+template <typename F>
+void RandomBase<RandomTraits>::forEachBernoulliHit(const BernoulliBuckets& buckets, F&& fn, Generator& generator)
+{
+    std::uniform_real_distribution<float> thinning(0.f, 1.f);
+
+    for (int level = 0; level < BernoulliBuckets::Levels; ++level) {
+        const std::vector<uint32_t>& indices = buckets.level(level);
+        const double levelProbability = BernoulliBuckets::levelProbability(level);
+        const auto scale = static_cast<float>(1.0 / levelProbability);
+
+        forEachBernoulliHit(0, indices.size(), levelProbability, [&](size_t position) {
+            const uint32_t index = indices[position];
+            if (thinning(generator) < buckets.probability(index) * scale) {
+                fn(static_cast<size_t>(index));
+            }
+        }, generator);
+    }
+}
+
+template <typename RandomTraits>
+template <typename F>
+void RandomBase<RandomTraits>::forEachBernoulliBatch(const BernoulliBuckets& buckets, F&& fn, Generator& generator)
+{
+    size_t batch[BernoulliBatchSize];
+    size_t count = 0;
+
+    forEachBernoulliHit(buckets, [&](size_t index) {
+        batch[count++] = index;
+        if (count == BernoulliBatchSize) {
+            fn(static_cast<const size_t*>(batch), count);
+            count = 0;
+        }
+    }, generator);
+
+    if (count > 0) {
+        fn(static_cast<const size_t*>(batch), count);
+    }
+}
+
 template <typename RandomTraits>
 template <typename T>
 T RandomBase<RandomTraits>::normalf(T mean, T stddev, Generator& generator)
@@ -187,20 +546,81 @@ void RandomBase<RandomTraits>::shuffle(RandomAccessIterator first, RandomAccessI
 }
 
 template <typename RandomTraits>
-template <typename C>
-typename C::value_type RandomBase<RandomTraits>::weightedFrom(const std::vector<float>& weights,
+template <typename W>
+size_t RandomBase<RandomTraits>::weightedIndex(const W& weights, Generator& generator)
+{
+    return weightedIndex(weights, [](const auto& weight) { return weight; }, generator);
+}
+
+template <typename RandomTraits>
+template <typename C, typename Projection, typename>
+size_t RandomBase<RandomTraits>::weightedIndex(const C& collection, Projection projection, Generator& generator)
+{
+    using Weight = std::decay_t<std::invoke_result_t<const Projection&, const RangeValueType<C>&>>;
+    static_assert(std::is_arithmetic<Weight>::value, "Arithmetic weight required.");
+
+    //
+    // INFO: Same summation order in both scans, running sum reaches
+    // 'total' exactly at last positive weight and target is below it
+    //
+    using Sum = std::conditional_t<std::is_integral<Weight>::value, uint64_t, double>;
+
+    Sum total = 0;
+    for (const auto& item : collection) {
+        const Weight weight = std::invoke(projection, item);
+        ally_assert(std::is_unsigned<Weight>::value || !(weight < Weight()), "negative weight");
+        total += static_cast<Sum>(weight);
+    }
+
+    ally_assert(total > 0, "at least one weight must be positive");
+
+    Sum target;
+    if constexpr (std::is_integral<Weight>::value) {
+        target = std::uniform_int_distribution<uint64_t>(0, total - 1)(generator);
+    } else {
+        target = std::uniform_real_distribution<double>(0.0, total)(generator);
+    }
+
+    Sum cumulative = 0;
+    size_t index = 0;
+    size_t lastPositive = 0;
+    for (const auto& item : collection) {
+        const auto weight = static_cast<Sum>(std::invoke(projection, item));
+        if (weight > 0) {
+            cumulative += weight;
+            if (target < cumulative) {
+                return index;
+            }
+            lastPositive = index;
+        }
+        ++index;
+    }
+
+    return lastPositive;
+}
+
+template <typename RandomTraits>
+template <typename W, typename C, typename>
+RangeValueType<C> RandomBase<RandomTraits>::weightedFrom(const W& weights,
     const C& collection,
     Generator& generator)
 {
-    std::discrete_distribution<size_t> dis(weights.begin(), weights.end());
+    ally_assert(std::distance(std::begin(weights), std::end(weights)) == std::distance(std::begin(collection), std::end(collection)));
 
-    auto offset = dis(generator);
-
-    auto it = collection.begin();
+    auto it = std::begin(collection);
     using OffsetType = typename std::iterator_traits<decltype(it)>::difference_type;
-    std::advance(it, static_cast<OffsetType>(offset));
+    std::advance(it, static_cast<OffsetType>(weightedIndex(weights, generator)));
 
-    ally_assert(it != collection.end());
+    return *it;
+}
+
+template <typename RandomTraits>
+template <typename C, typename Projection, typename>
+RangeValueType<C> RandomBase<RandomTraits>::weightedFrom(const C& collection, Projection projection, Generator& generator)
+{
+    auto it = std::begin(collection);
+    using OffsetType = typename std::iterator_traits<decltype(it)>::difference_type;
+    std::advance(it, static_cast<OffsetType>(weightedIndex(collection, projection, generator)));
 
     return *it;
 }
@@ -232,6 +652,83 @@ typename C::value_type RandomBase<RandomTraits>::uniformFrom(const C& collection
     return *it;
 }
 
+template <typename RandomTraits>
+template <typename T>
+RandomView<UniformDistribution<T>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::uniformView(T from, T to, Generator& generator)
+{
+    static_assert(std::is_arithmetic<T>::value, "Arithmetic type required.");
+    return { UniformDistribution<T>(from, to), generator };
+}
+
+template <typename RandomTraits>
+template <typename T>
+RandomView<std::uniform_int_distribution<T>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::probabilityView(Generator& generator)
+{
+    static_assert(std::is_integral<T>::value, "Integral required.");
+    return { std::uniform_int_distribution<T>(static_cast<T>(0), static_cast<T>(100)), generator };
+}
+
+template <typename RandomTraits>
+template <typename T>
+RandomView<std::uniform_real_distribution<T>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::probabilityfView(Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    std::uniform_real_distribution<T> dis(
+        static_cast<T>(0.f), static_cast<T>(std::nextafter(1.f, std::numeric_limits<T>::max())));
+    // nextafter used to simulate closed interval, same as 'probabilityf'
+    return { dis, generator };
+}
+
+template <typename RandomTraits>
+inline RandomView<std::bernoulli_distribution, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::yesNoView(Generator& generator)
+{
+    return { std::bernoulli_distribution(0.5), generator };
+}
+
+template <typename RandomTraits>
+template <typename T>
+RandomView<std::normal_distribution<T>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::normalfView(T mean, T stddev, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    return { std::normal_distribution<T>(mean, stddev), generator };
+}
+
+template <typename RandomTraits>
+template <typename T>
+RandomView<typename RandomBase<RandomTraits>::template TriangularDistribution<T>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::triangularfView(T a, T b, T c, Generator& generator)
+{
+    static_assert(std::is_floating_point<T>::value, "Floating point required.");
+    return { TriangularDistribution<T> { a, b, c }, generator };
+}
+
+template <typename RandomTraits>
+template <typename C>
+RandomView<CollectionDistribution<C, std::uniform_int_distribution<size_t>>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::uniformFromView(const C& collection, Generator& generator)
+{
+    ally_assert(!collection.empty());
+
+    std::uniform_int_distribution<size_t> offsets(0, collection.size() - 1);
+    return { CollectionDistribution<C, std::uniform_int_distribution<size_t>>(collection, offsets), generator };
+}
+
+template <typename RandomTraits>
+template <typename C>
+RandomView<CollectionDistribution<C, std::discrete_distribution<size_t>>, typename RandomBase<RandomTraits>::Generator>
+RandomBase<RandomTraits>::weightedFromView(const std::vector<float>& weights, const C& collection, Generator& generator)
+{
+    ally_assert(weights.size() == collection.size());
+
+    std::discrete_distribution<size_t> offsets(weights.begin(), weights.end());
+    return { CollectionDistribution<C, std::discrete_distribution<size_t>>(collection, offsets), generator };
+}
+
 //
 // use types below
 //
@@ -242,11 +739,29 @@ struct FastRandomTraits
     static GeneratorType& generator();
 };
 
+//
+// INFO: Server seed is shared by every node of cluster, set it at startup
+// before first use, generator is reseeded. Without it seed is random per process
+//
 struct ServerRandomTraits
 {
     using GeneratorType = std::mt19937_64;
     static GeneratorType& generator();
+
+    static void setSeed(uint64_t seed);
+    static uint64_t seed();
+};
+
+//
+// INFO: Generator per thread, use it from worker threads,
+// 'Random' and 'ServerRandom' generators are shared and not thread safe
+//
+struct ThreadRandomTraits
+{
+    using GeneratorType = Pcg32;
+    static GeneratorType& generator();
 };
 
 using Random = RandomBase<FastRandomTraits>;
 using ServerRandom = RandomBase<ServerRandomTraits>;
+using ThreadRandom = RandomBase<ThreadRandomTraits>;
@@ -0,0 +1,499 @@
+#include "RandomGraph.hpp"
+#include "Assertions.hpp"
+#include "Hash.hpp"
+#include "Random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Graph file is written and mapped in place, little-endian host required.");
+#endif
+
+namespace {
+constexpr uint32_t GraphMagic = 0x52474c41; // "ALGR"
+constexpr uint32_t GraphVersion = 1;
+constexpr uint64_t SymmetricFlag = 1;
+
+constexpr size_t EdgesPerChunk = size_t(1) << 16u;
+constexpr size_t RowsPerChunk = 1024;
+constexpr size_t RowsPerSortTask = 4096;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t vertices;
+    uint64_t edges;
+    uint64_t flags;
+};
+
+static_assert(sizeof(FileHeader) == 32, "File header must be packed.");
+
+//
+// INFO: Uniform in [0, range) from 64-bit hash, multiply-shift instead of modulo
+//
+uint64_t scaledHash(uint64_t hash, uint64_t range)
+{
+#if defined(__SIZEOF_INT128__)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * range) >> 64u);
+#else
+    return hash % range;
+#endif
+}
+
+template <typename F>
+void parallel(size_t threads, size_t tasks, F&& fn)
+{
+    threads = std::min(threads, tasks);
+
+    std::atomic<size_t> next { 0 };
+    auto worker = [&next, &fn, tasks] {
+        for (size_t task = next.fetch_add(1, std::memory_order_relaxed); task < tasks; task = next.fetch_add(1, std::memory_order_relaxed)) {
+            fn(task);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads > 1 ? threads - 1 : 0);
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
+
+class ErdosRenyiSource {
+public:
+    ErdosRenyiSource(uint32_t vertices, double p, uint64_t seed)
+        : m_vertices(vertices)
+        , m_p(p)
+        , m_seed(seed)
+    {
+    }
+
+    size_t chunks() const { return (m_vertices + RowsPerChunk - 1) / RowsPerChunk; }
+
+    template <typename F>
+    void generate(size_t chunk, F&& emit) const
+    {
+        Pcg32 generator(m_seed, chunk);
+
+        const size_t first = chunk * RowsPerChunk;
+        const size_t last = std::min<size_t>(first + RowsPerChunk, m_vertices);
+        for (size_t row = first; row < last; ++row) {
+            const auto source = static_cast<uint32_t>(row);
+            ThreadRandom::forEachBernoulliHit(row + 1, m_vertices, m_p, [&emit, source](size_t target) {
+                emit(source, static_cast<uint32_t>(target));
+            }, generator);
+        }
+    }
+
+private:
+    uint32_t m_vertices;
+    double m_p;
+    uint64_t m_seed;
+};
+
+//
+// INFO: Edge 'e' goes from vertex '1 + e / m'. Endpoint list is
+// 'source(0), target(0), source(1), target(1), ...', target of 'e' copies
+// endpoint at hashed position below '2e', odd position is target of
+// earlier edge and is resolved the same way. Chain is short on average,
+// every step halves expected position
+//
+class BarabasiAlbertSource {
+public:
+    BarabasiAlbertSource(uint32_t vertices, uint32_t edgesPerVertex, uint64_t seed)
+        : m_edgesPerVertex(edgesPerVertex)
+        , m_edges(vertices > 1 ? static_cast<uint64_t>(vertices - 1) * edgesPerVertex : 0)
+        , m_seed(seed)
+    {
+    }
+
+    size_t chunks() const { return static_cast<size_t>((m_edges + EdgesPerChunk - 1) / EdgesPerChunk); }
+
+    template <typename F>
+    void generate(size_t chunk, F&& emit) const
+    {
+        const uint64_t first = static_cast<uint64_t>(chunk) * EdgesPerChunk;
+        const uint64_t last = std::min<uint64_t>(first + EdgesPerChunk, m_edges);
+        for (uint64_t edge = first; edge < last; ++edge) {
+            emit(source(edge), target(edge));
+        }
+    }
+
+private:
+    uint32_t source(uint64_t edge) const { return static_cast<uint32_t>(1 + edge / m_edgesPerVertex); }
+
+    uint32_t target(uint64_t edge) const
+    {
+        while (edge > 0) {
+            const uint64_t position = scaledHash(mixHash(edge, m_seed), 2 * edge);
+            if (position % 2 == 0) {
+                return source(position / 2);
+            }
+            edge = position / 2;
+        }
+        return 0;
+    }
+
+private:
+    uint64_t m_edgesPerVertex;
+    uint64_t m_edges;
+    uint64_t m_seed;
+};
+
+class RmatSource {
+public:
+    RmatSource(uint32_t scale, uint64_t edges, float a, float b, float c, uint64_t seed)
+        : m_scale(scale)
+        , m_edges(edges)
+        , m_a(threshold(a))
+        , m_ab(threshold(a + b))
+        , m_abc(threshold(a + b + c))
+        , m_seed(seed)
+    {
+    }
+
+    size_t chunks() const { return static_cast<size_t>((m_edges + EdgesPerChunk - 1) / EdgesPerChunk); }
+
+    template <typename F>
+    void generate(size_t chunk, F&& emit) const
+    {
+        Pcg32 generator(m_seed, chunk);
+
+        const uint64_t first = static_cast<uint64_t>(chunk) * EdgesPerChunk;
+        const uint64_t last = std::min<uint64_t>(first + EdgesPerChunk, m_edges);
+        for (uint64_t edge = first; edge < last; ++edge) {
+            uint32_t source = 0;
+            uint32_t target = 0;
+            for (uint32_t level = 0; level < m_scale; ++level) {
+                const uint32_t u = generator();
+                source = (source << 1u) | static_cast<uint32_t>(u >= m_ab);
+                target = (target << 1u) | static_cast<uint32_t>((u >= m_a && u < m_ab) || u >= m_abc);
+            }
+            emit(source, target);
+        }
+    }
+
+private:
+    //
+    // INFO: Quadrant is chosen by comparing raw 32-bit draw with scaled
+    // cumulative probabilities, one generator call per level
+    //
+    static uint64_t threshold(float probability)
+    {
+        return static_cast<uint64_t>(std::min(1.0, static_cast<double>(probability)) * 4294967296.0);
+    }
+
+private:
+    uint32_t m_scale;
+    uint64_t m_edges;
+    uint64_t m_a;
+    uint64_t m_ab;
+    uint64_t m_abc;
+    uint64_t m_seed;
+};
+
+//
+// INFO: Points are bucketed into grid with cell not smaller than radius,
+// neighbours of point are in its cell and eight adjacent ones. Grid is
+// capped at about one cell per point, so memory is O(vertices)
+//
+class GeometricSource {
+public:
+    GeometricSource(uint32_t vertices, double radius, uint64_t seed, size_t threads)
+        : m_radiusSquared(static_cast<float>(radius * radius))
+    {
+        const double byRadius = radius > 0.0 ? std::floor(1.0 / radius) : 1.0;
+        const double byCount = std::floor(std::sqrt(static_cast<double>(vertices)));
+        m_grid = static_cast<uint32_t>(std::max(1.0, std::min(byRadius, byCount)));
+
+        std::vector<float> xs(vertices);
+        std::vector<float> ys(vertices);
+        std::vector<uint32_t> cells(vertices);
+        parallel(threads, (vertices + EdgesPerChunk - 1) / EdgesPerChunk, [&](size_t chunk) {
+            Pcg32 generator(seed, chunk);
+
+            const size_t first = chunk * EdgesPerChunk;
+            const size_t last = std::min<size_t>(first + EdgesPerChunk, vertices);
+            for (size_t i = first; i < last; ++i) {
+                xs[i] = ThreadRandom::uniformf<float>(generator);
+                ys[i] = ThreadRandom::uniformf<float>(generator);
+                cells[i] = cellOf(xs[i], ys[i]);
+            }
+        });
+
+        m_cellStarts.assign(static_cast<size_t>(m_grid) * m_grid + 1, 0);
+        for (uint32_t cell : cells) {
+            ++m_cellStarts[cell + 1];
+        }
+        for (size_t cell = 1; cell < m_cellStarts.size(); ++cell) {
+            m_cellStarts[cell] += m_cellStarts[cell - 1];
+        }
+
+        m_xs.resize(vertices);
+        m_ys.resize(vertices);
+        std::vector<uint32_t> cursors(m_cellStarts.begin(), m_cellStarts.end() - 1);
+        for (size_t i = 0; i < vertices; ++i) {
+            const uint32_t vertex = cursors[cells[i]]++;
+            m_xs[vertex] = xs[i];
+            m_ys[vertex] = ys[i];
+        }
+    }
+
+    size_t chunks() const { return m_grid; }
+
+    template <typename F>
+    void generate(size_t chunk, F&& emit) const
+    {
+        const auto row = static_cast<uint32_t>(chunk);
+        for (uint32_t column = 0; column < m_grid; ++column) {
+            const uint32_t cell = row * m_grid + column;
+            for (uint32_t u = m_cellStarts[cell]; u < m_cellStarts[cell + 1]; ++u) {
+                forEachNeighbourCell(row, column, [&](uint32_t other) {
+                    for (uint32_t v = std::max(m_cellStarts[other], u + 1); v < m_cellStarts[other + 1]; ++v) {
+                        const float dx = m_xs[u] - m_xs[v];
+                        const float dy = m_ys[u] - m_ys[v];
+                        if (dx * dx + dy * dy < m_radiusSquared) {
+                            emit(u, v);
+                        }
+                    }
+                });
+            }
+        }
+    }
+
+private:
+    uint32_t cellOf(float x, float y) const
+    {
+        const uint32_t last = m_grid - 1;
+        const uint32_t column = std::min(static_cast<uint32_t>(x * static_cast<float>(m_grid)), last);
+        const uint32_t row = std::min(static_cast<uint32_t>(y * static_cast<float>(m_grid)), last);
+        return row * m_grid + column;
+    }
+
+    template <typename F>
+    void forEachNeighbourCell(uint32_t row, uint32_t column, F&& fn) const
+    {
+        const uint32_t rowLast = std::min(row + 1, m_grid - 1);
+        const uint32_t columnLast = std::min(column + 1, m_grid - 1);
+        for (uint32_t r = row > 0 ? row - 1 : 0; r <= rowLast; ++r) {
+            for (uint32_t c = column > 0 ? column - 1 : 0; c <= columnLast; ++c) {
+                fn(r * m_grid + c);
+            }
+        }
+    }
+
+private:
+    float m_radiusSquared;
+    uint32_t m_grid = 1;
+    std::vector<uint32_t> m_cellStarts;
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+};
+
+size_t threadCount(size_t requested)
+{
+    const size_t hardware = std::max<unsigned>(1, std::thread::hardware_concurrency());
+    return requested == 0 ? hardware : requested;
+}
+
+template <typename Source>
+bool writeGraph(const std::string& path, uint32_t vertices, const Source& source, const GraphOptions& options)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const size_t threads = threadCount(options.threads);
+    const bool symmetric = options.symmetric;
+
+    std::vector<std::atomic<uint64_t>> cursors(static_cast<size_t>(vertices) + 1);
+    parallel(threads, source.chunks(), [&](size_t chunk) {
+        source.generate(chunk, [&cursors, symmetric](uint32_t u, uint32_t v) {
+            cursors[u].fetch_add(1, std::memory_order_relaxed);
+            if (symmetric) {
+                cursors[v].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    });
+
+    uint64_t edges = 0;
+    for (auto& cursor : cursors) {
+        edges += cursor.exchange(edges, std::memory_order_relaxed);
+    }
+
+    const size_t offsetBytes = (static_cast<size_t>(vertices) + 1) * sizeof(uint64_t);
+    const size_t fileSize = sizeof(FileHeader) + offsetBytes + static_cast<size_t>(edges) * sizeof(uint32_t);
+
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(fileSize)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    auto* bytes = static_cast<uint8_t*>(data);
+    auto* offsets = reinterpret_cast<uint64_t*>(bytes + sizeof(FileHeader));
+    auto* targets = reinterpret_cast<uint32_t*>(bytes + sizeof(FileHeader) + offsetBytes);
+
+    const FileHeader header = { GraphMagic, GraphVersion, vertices, edges, symmetric ? SymmetricFlag : 0 };
+    std::memcpy(bytes, &header, sizeof(header));
+    for (size_t vertex = 0; vertex <= vertices; ++vertex) {
+        offsets[vertex] = cursors[vertex].load(std::memory_order_relaxed);
+    }
+
+    parallel(threads, source.chunks(), [&](size_t chunk) {
+        source.generate(chunk, [&cursors, targets, symmetric](uint32_t u, uint32_t v) {
+            targets[cursors[u].fetch_add(1, std::memory_order_relaxed)] = v;
+            if (symmetric) {
+                targets[cursors[v].fetch_add(1, std::memory_order_relaxed)] = u;
+            }
+        });
+    });
+
+    //
+    // INFO: Scatter order depends on thread timing, sorted rows make file
+    // the same for any thread count
+    //
+    parallel(threads, (static_cast<size_t>(vertices) + RowsPerSortTask - 1) / RowsPerSortTask, [&](size_t task) {
+        const size_t first = task * RowsPerSortTask;
+        const size_t last = std::min<size_t>(first + RowsPerSortTask, vertices);
+        for (size_t vertex = first; vertex < last; ++vertex) {
+            std::sort(targets + offsets[vertex], targets + offsets[vertex + 1]);
+        }
+    });
+
+    return munmap(data, fileSize) == 0;
+#else
+    static_cast<void>(path);
+    static_cast<void>(vertices);
+    static_cast<void>(source);
+    static_cast<void>(options);
+    return false;
+#endif
+}
+}
+
+bool generateErdosRenyi(const std::string& path, uint32_t vertices, double p, const GraphOptions& options)
+{
+    return writeGraph(path, vertices, ErdosRenyiSource(vertices, p, options.seed), options);
+}
+
+bool generateBarabasiAlbert(const std::string& path, uint32_t vertices, uint32_t edgesPerVertex, const GraphOptions& options)
+{
+    ally_assert(edgesPerVertex > 0, "vertex must bring at least one edge");
+    return writeGraph(path, vertices, BarabasiAlbertSource(vertices, edgesPerVertex, options.seed), options);
+}
+
+bool generateRmat(const std::string& path, uint32_t scale, uint64_t edges, float a, float b, float c, const GraphOptions& options)
+{
+    ally_assert(scale > 0 && scale < 32, "R-MAT vertex count must fit 32 bits");
+    ally_assert(a >= 0.f && b >= 0.f && c >= 0.f && a + b + c <= 1.f, "R-MAT quadrant probabilities");
+    return writeGraph(path, uint32_t(1) << scale, RmatSource(scale, edges, a, b, c, options.seed), options);
+}
+
+bool generateGeometric(const std::string& path, uint32_t vertices, double radius, const GraphOptions& options)
+{
+    const GeometricSource source(vertices, radius, options.seed, threadCount(options.threads));
+    return writeGraph(path, vertices, source, options);
+}
+
+//
+// MappedGraph
+//
+
+MappedGraph::MappedGraph(const std::string& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        return;
+    }
+
+    const auto fileSize = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    //
+    // INFO: Vertex count is checked first, so offset bytes can't overflow,
+    // edge count is derived from what is left instead of multiplied
+    //
+    bool valid = header.magic == GraphMagic && header.version == GraphVersion && header.vertices <= UINT32_MAX;
+    const uint64_t offsetBytes = valid ? (header.vertices + 1) * sizeof(uint64_t) : 0;
+    const uint64_t targetBytes = fileSize - sizeof(FileHeader) - offsetBytes;
+    valid = valid
+        && fileSize - sizeof(FileHeader) >= offsetBytes
+        && targetBytes % sizeof(uint32_t) == 0
+        && header.edges == targetBytes / sizeof(uint32_t);
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const auto* offsets = reinterpret_cast<const uint64_t*>(bytes + sizeof(FileHeader));
+
+    //
+    // INFO: Rows must be ordered and end at edge count, or 'neighbors' reads
+    // outside of mapping. Targets aren't scanned, their count can be billions
+    //
+    if (valid) {
+        valid = offsets[0] == 0 && offsets[header.vertices] == header.edges;
+        for (uint64_t vertex = 0; valid && vertex < header.vertices; ++vertex) {
+            valid = offsets[vertex] <= offsets[vertex + 1];
+        }
+    }
+
+    if (!valid) {
+        munmap(data, fileSize);
+        return;
+    }
+
+    m_vertices = static_cast<uint32_t>(header.vertices);
+    m_edges = header.edges;
+    m_symmetric = (header.flags & SymmetricFlag) != 0;
+
+    m_offsets = offsets;
+    m_targets = reinterpret_cast<const uint32_t*>(bytes + sizeof(FileHeader) + offsetBytes);
+    m_data = data;
+    m_dataSize = fileSize;
+#else
+    static_cast<void>(path);
+#endif
+}
+
+MappedGraph::~MappedGraph()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (m_data) {
+        munmap(m_data, m_dataSize);
+    }
+#endif
+}
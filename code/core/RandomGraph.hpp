@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// INFO: Synthetic graphs for offline scale tests, written as CSR straight into
+// memory-mapped file, see 'MappedGraph'. Vertices are 32-bit, edges 64-bit.
+//
+// Edges are generated in fixed chunks, chunk 'k' draws from 'ThreadRandom'
+// functions with its own 'Pcg32(seed, k)' stream, so output depends only on
+// parameters and seed, not on thread count. Generation runs twice: first
+// pass counts degrees, second regenerates the same edges and scatters them
+// into file, edge list is never held in memory. Rows are sorted at the end.
+//
+// Generators store every edge once as they produce it, 'symmetric' stores
+// reverse edge too. Multi-edges of Barabasi-Albert and R-MAT are kept, so are
+// self-loops: R-MAT may pick the same row and column, Barabasi-Albert vertex
+// may copy endpoint of its own earlier edge
+//
+// 'generateErdosRenyi' - G(n, p), pairs 'u < v', geometric skipping per row
+// 'generateBarabasiAlbert' - preferential attachment, 'edgesPerVertex' from each new vertex
+//     to older ones, Batagelj-Brandes edge copying with hashed choices, every edge is
+//     computed independently (Sanders, Schulz 2016)
+// 'generateRmat' - 2^scale vertices, quadrant probabilities 'a, b, c' and '1 - a - b - c'
+// 'generateGeometric' - points in unit square, edge when distance is below 'radius',
+//     vertices are numbered by grid cell, so neighbours have close ids
+//
+// Usage:
+//   GraphOptions options;
+//   options.symmetric = true;
+//   generateRmat("social.csr", 26, 1'000'000'000, 0.57f, 0.19f, 0.19f, options);
+//   MappedGraph graph("social.csr");
+//
+struct GraphOptions {
+    //
+    // INFO: Zero is 'std::thread::hardware_concurrency'
+    //
+    size_t threads = 0;
+    uint64_t seed = 0x9b05688c2b3e6c1full;
+    bool symmetric = false;
+};
+
+bool generateErdosRenyi(const std::string& path, uint32_t vertices, double p, const GraphOptions& options = GraphOptions());
+bool generateBarabasiAlbert(const std::string& path, uint32_t vertices, uint32_t edgesPerVertex, const GraphOptions& options = GraphOptions());
+bool generateRmat(const std::string& path, uint32_t scale, uint64_t edges, float a, float b, float c, const GraphOptions& options = GraphOptions());
+bool generateGeometric(const std::string& path, uint32_t vertices, double radius, const GraphOptions& options = GraphOptions());
+
+//
+// INFO: File layout, all fields little-endian:
+// [header: magic, version, vertices, edges, flags][offsets: (vertices + 1) uint64][targets: edges uint32]
+//
+// File is written and mapped in place without byte swapping, so only
+// little-endian hosts build it, see 'static_assert' in source. Opening checks
+// header, file size and that offsets grow from 0 to edge count, targets
+// are trusted
+//
+class MappedGraph {
+public:
+    explicit MappedGraph(const std::string& path);
+    ~MappedGraph();
+
+    MappedGraph(const MappedGraph&) = delete;
+    MappedGraph& operator=(const MappedGraph&) = delete;
+
+    bool isValid() const { return m_data != nullptr; }
+    bool isSymmetric() const { return m_symmetric; }
+
+    uint32_t vertexCount() const { return m_vertices; }
+    uint64_t edgeCount() const { return m_edges; }
+
+    uint64_t degree(uint32_t vertex) const { return m_offsets[vertex + 1] - m_offsets[vertex]; }
+    const uint32_t* neighbors(uint32_t vertex) const { return m_targets + m_offsets[vertex]; }
+
+    const uint64_t* offsets() const { return m_offsets; }
+    const uint32_t* targets() const { return m_targets; }
+
+private:
+    uint32_t m_vertices = 0;
+    uint64_t m_edges = 0;
+    bool m_symmetric = false;
+    const uint64_t* m_offsets = nullptr;
+    const uint32_t* m_targets = nullptr;
+    void* m_data = nullptr;
+    size_t m_dataSize = 0;
+};
@@ -0,0 +1,78 @@
+#include "RandomOrder.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+//
+// INFO: Shard takes whole cache line, so workers meet on mutexes only,
+// not on neighbours of the shard they hold
+//
+struct alignas(64) Shard {
+    std::mutex mutex;
+    uint64_t value = 0;
+};
+}
+
+std::function<double()> shardContentionSampler(size_t shards, size_t threads, size_t passes, bool randomOrder, uint64_t* contended)
+{
+    std::shared_ptr<Shard[]> table(new Shard[shards]);
+
+    return [table, shards, threads, passes, randomOrder, contended]() {
+        std::atomic<bool> go { false };
+        std::atomic<uint64_t> misses { 0 };
+
+        const auto work = [&]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            uint64_t localMisses = 0;
+            const auto visit = [&](size_t index) {
+                Shard& shard = table[index];
+                if (!shard.mutex.try_lock()) {
+                    ++localMisses;
+                    shard.mutex.lock();
+                }
+                ++shard.value;
+                shard.mutex.unlock();
+            };
+
+            for (size_t pass = 0; pass < passes; ++pass) {
+                if (randomOrder) {
+                    randomOrderFor(shards, visit);
+                } else {
+                    for (size_t index = 0; index < shards; ++index) {
+                        visit(index);
+                    }
+                }
+            }
+            misses.fetch_add(localMisses, std::memory_order_relaxed);
+        };
+
+        //
+        // INFO: Workers are started before the clock and released together,
+        // thread creation isn't measured
+        //
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (contended) {
+            *contended += misses.load(std::memory_order_relaxed);
+        }
+        return seconds;
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Random.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+
+//
+// INFO: Visits every index of [0, count) once in order
+// 'start, start + stride, start + 2 * stride, ...' modulo count, stride is
+// coprime with count, so sequence is a permutation. Workers walking shared
+// shards or lock tables from different random starts with different strides
+// rarely meet on the same element, nothing is shuffled or allocated.
+// Permutation is cheap, not uniform: there are only 'count * phi(count)' of them
+//
+class RandomOrder {
+public:
+    template <typename Generator>
+    RandomOrder(size_t count, Generator& generator)
+        : m_count(count)
+    {
+        if (count < 2) {
+            return;
+        }
+
+        std::uniform_int_distribution<size_t> offsets(0, count - 1);
+        m_start = offsets(generator);
+
+        //
+        // INFO: Coprime stride is found after few draws, fraction of
+        // coprime numbers below 'count' decreases like 1 / log(log(count))
+        //
+        std::uniform_int_distribution<size_t> strides(1, count - 1);
+        do {
+            m_stride = strides(generator);
+        } while (std::gcd(m_stride, count) != 1);
+    }
+
+    size_t size() const { return m_count; }
+    size_t start() const { return m_start; }
+    size_t stride() const { return m_stride; }
+
+    template <typename F>
+    void forEach(F&& fn) const
+    {
+        size_t index = m_start;
+        for (size_t i = 0; i < m_count; ++i) {
+            fn(index);
+
+            //
+            // INFO: Both are below count, one subtraction replaces modulo
+            //
+            index += m_stride;
+            index -= index >= m_count ? m_count : 0;
+        }
+    }
+
+private:
+    size_t m_count = 0;
+    size_t m_start = 0;
+    size_t m_stride = 1;
+};
+
+//
+// Usage:
+//   randomOrderFor(shards, [](Shard& shard) { std::lock_guard lock(shard.mutex); ... });
+//   randomOrderFor(tableSize, [](size_t index) { ... });
+//
+// Order is drawn from 'ThreadRandom', every worker thread gets its own
+//
+template <typename F>
+void randomOrderFor(size_t count, F&& fn)
+{
+    RandomOrder(count, ThreadRandomTraits::generator()).forEach(fn);
+}
+
+template <typename C, typename F, typename = std::enable_if_t<!std::is_arithmetic<C>::value>>
+void randomOrderFor(C& range, F&& fn)
+{
+    auto first = std::begin(range);
+    const auto count = static_cast<size_t>(std::distance(first, std::end(range)));
+
+    using OffsetType = typename std::iterator_traits<decltype(first)>::difference_type;
+    RandomOrder(count, ThreadRandomTraits::generator()).forEach([&fn, first](size_t index) {
+        fn(first[static_cast<OffsetType>(index)]);
+    });
+}
+
+//
+// INFO: Sampler for 'compareBenchmarks' (Benchmark.hpp), 'threads' workers make
+// 'passes' over 'shards' mutex-protected counters, in index order or through
+// 'randomOrderFor', sample is wall time of whole run in seconds. Lock attempts
+// that found shard taken are added to 'contended' when it isn't null, it must
+// outlive sampler. Workers inherit affinity of calling thread, so don't pin it,
+// contention shows only when workers run on different cores
+//
+// Usage:
+//   BenchmarkOptions options;
+//   options.cpu = -1;
+//   uint64_t sequentialMisses = 0, randomMisses = 0;
+//   auto result = compareBenchmarks(shardContentionSampler(64, 8, 2000, false, &sequentialMisses),
+//       shardContentionSampler(64, 8, 2000, true, &randomMisses), options);
+//   writeComparison(std::cout, "randomOrderFor shards", result);
+//
+std::function<double()> shardContentionSampler(size_t shards, size_t threads, size_t passes, bool randomOrder, uint64_t* contended = nullptr);
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+//
+// INFO: Endless view over a distribution. Values are produced in blocks of
+// 'BlockSize' by one tight loop over the same distribution and generator,
+// then handed out one by one. Distribution setup and 'RandomTraits::generator()'
+// lookup happen once per view, not once per element
+//
+// Usage: for (float x : Random::uniformView(0.f, 1.f) | std::views::take(n)) { ... }
+//
+// View keeps a pointer to the generator, so generator must outlive the view
+//
+template <typename Distribution, typename Generator, size_t BlockSize = 256>
+class RandomView
+#if defined(__cpp_lib_ranges)
+    : public std::ranges::view_base
+#endif
+{
+public:
+    using value_type = std::decay_t<decltype(std::declval<Distribution&>()(std::declval<Generator&>()))>;
+
+    struct Sentinel {
+    };
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = RandomView::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        Iterator() = default;
+        explicit Iterator(RandomView* view)
+            : m_view(view)
+        {
+        }
+
+        reference operator*() const { return m_view->m_block[m_view->m_position]; }
+        pointer operator->() const { return &m_view->m_block[m_view->m_position]; }
+
+        Iterator& operator++()
+        {
+            m_view->next();
+            return *this;
+        }
+
+        void operator++(int) { m_view->next(); }
+
+        friend bool operator==(const Iterator&, Sentinel) { return false; }
+        friend bool operator==(Sentinel, const Iterator&) { return false; }
+        friend bool operator!=(const Iterator&, Sentinel) { return true; }
+        friend bool operator!=(Sentinel, const Iterator&) { return true; }
+
+    private:
+        RandomView* m_view = nullptr;
+    };
+
+    RandomView(Distribution distribution, Generator& generator)
+        : m_distribution(std::move(distribution))
+        , m_generator(&generator)
+    {
+    }
+
+    Iterator begin()
+    {
+        if (m_position == BlockSize) {
+            refill();
+        }
+        return Iterator(this);
+    }
+
+    Sentinel end() const { return {}; }
+
+private:
+    void next()
+    {
+        if (++m_position == BlockSize) {
+            refill();
+        }
+    }
+
+    void refill()
+    {
+        auto& generator = *m_generator;
+        for (auto& value : m_block) {
+            value = m_distribution(generator);
+        }
+        m_position = 0;
+    }
+
+private:
+    Distribution m_distribution;
+    Generator* m_generator;
+    std::array<value_type, BlockSize> m_block;
+    size_t m_position = BlockSize;
+};
+
+template <typename T>
+using UniformDistribution = std::conditional_t<std::is_integral<T>::value,
+    std::uniform_int_distribution<T>,
+    std::uniform_real_distribution<T>>;
+
+//
+// INFO: Picks from a random access collection through a distribution of offsets,
+// collection is kept by reference and must outlive the view
+//
+template <typename C, typename OffsetDistribution>
+class CollectionDistribution {
+public:
+    using result_type = typename C::value_type;
+
+    CollectionDistribution(const C& collection, OffsetDistribution offsets)
+        : m_collection(&collection)
+        , m_offsets(std::move(offsets))
+    {
+        using Category = typename std::iterator_traits<typename C::const_iterator>::iterator_category;
+        static_assert(std::is_base_of<std::random_access_iterator_tag, Category>::value, "Random access collection required.");
+    }
+
+    template <typename Generator>
+    result_type operator()(Generator& generator)
+    {
+        using OffsetType = typename std::iterator_traits<typename C::const_iterator>::difference_type;
+        return *(m_collection->begin() + static_cast<OffsetType>(m_offsets(generator)));
+    }
+
+private:
+    const C* m_collection;
+    OffsetDistribution m_offsets;
+};
+
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "Bits.hpp"
+#include "Random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct SampleSortOptions {
+    //
+    // INFO: Zero is 'std::thread::hardware_concurrency'
+    //
+    size_t threads = 0;
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+};
+
+//
+// INFO: Parallel sample sort for large arrays (millions of elements and more).
+//
+// Splitters are picked from random oversample drawn by 'ServerRandom' from
+// generator seeded by 'options.seed', elements are classified by branchless
+// descent of implicit splitter tree (Eytzinger layout), every splitter has its
+// own equality bucket, so many duplicate keys end up in buckets that need no
+// sorting. Input is classified and scattered in fixed size blocks, result
+// doesn't depend on thread count, for fixed seed it is the same every run.
+// Buckets are sorted by 'std::sort', threads take them from shared counter,
+// biggest buckets first. Not stable, needs extra buffer of input size
+//
+// Usage:
+//   sampleSort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.time < b.time; });
+//
+template <typename RandomAccessIterator, typename Compare>
+class SampleSorter {
+public:
+    using T = typename std::iterator_traits<RandomAccessIterator>::value_type;
+
+    static constexpr size_t MaxLogBuckets = 8;
+    static constexpr size_t Oversampling = 16;
+    static constexpr size_t BlockSize = size_t(1) << 16u;
+    static constexpr size_t SequentialThreshold = size_t(1) << 17u;
+
+    SampleSorter(Compare compare, const SampleSortOptions& options)
+        : m_compare(compare)
+        , m_options(options)
+    {
+    }
+
+    void sort(RandomAccessIterator first, RandomAccessIterator last)
+    {
+        const auto size = static_cast<size_t>(last - first);
+        size_t threads = m_options.threads != 0 ? m_options.threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+        if (size < SequentialThreshold || threads == 1) {
+            std::sort(first, last, m_compare);
+            return;
+        }
+
+        buildTree(first, size);
+
+        const size_t blocks = (size + BlockSize - 1) / BlockSize;
+        const size_t ids = bucketIds();
+        threads = std::min(threads, blocks);
+
+        //
+        // INFO: Count elements of every bucket in every block
+        //
+        std::vector<size_t> offsets(blocks * ids, 0);
+        parallel(threads, blocks, [&](size_t block) {
+            size_t* counts = offsets.data() + block * ids;
+            const size_t begin = block * BlockSize;
+            const size_t end = std::min(size, begin + BlockSize);
+            for (size_t i = begin; i < end; ++i) {
+                ++counts[classify(first[static_cast<std::ptrdiff_t>(i)])];
+            }
+        });
+
+        //
+        // INFO: Bucket major prefix sums, block b writes bucket i after blocks before b
+        //
+        std::vector<size_t> bucketBegin(ids + 1, 0);
+        size_t total = 0;
+        for (size_t id = 0; id < ids; ++id) {
+            bucketBegin[id] = total;
+            for (size_t block = 0; block < blocks; ++block) {
+                const size_t count = offsets[block * ids + id];
+                offsets[block * ids + id] = total;
+                total += count;
+            }
+        }
+        bucketBegin[ids] = total;
+
+        Buffer buffer(size);
+        parallel(threads, blocks, [&](size_t block) {
+            size_t* cursors = offsets.data() + block * ids;
+            const size_t begin = block * BlockSize;
+            const size_t end = std::min(size, begin + BlockSize);
+            for (size_t i = begin; i < end; ++i) {
+                auto& value = first[static_cast<std::ptrdiff_t>(i)];
+                buffer.construct(cursors[classify(value)]++, std::move(value));
+            }
+        });
+
+        std::vector<size_t> order(ids);
+        for (size_t id = 0; id < ids; ++id) {
+            order[id] = id;
+        }
+        std::sort(order.begin(), order.end(), [&bucketBegin](size_t a, size_t b) {
+            const size_t sizeA = bucketBegin[a + 1] - bucketBegin[a];
+            const size_t sizeB = bucketBegin[b + 1] - bucketBegin[b];
+            return sizeA > sizeB || (sizeA == sizeB && a < b);
+        });
+
+        parallel(threads, ids, [&](size_t task) {
+            const size_t id = order[task];
+            const size_t begin = bucketBegin[id];
+            const size_t end = bucketBegin[id + 1];
+
+            auto out = first + static_cast<std::ptrdiff_t>(begin);
+            for (size_t i = begin; i < end; ++i) {
+                out[static_cast<std::ptrdiff_t>(i - begin)] = std::move(buffer[i]);
+                buffer.destroy(i);
+            }
+
+            if (!isEqualityBucket(id)) {
+                std::sort(out, out + static_cast<std::ptrdiff_t>(end - begin), m_compare);
+            }
+        });
+    }
+
+private:
+    //
+    // INFO: Raw storage, elements are move constructed into it during scatter
+    //
+    class Buffer {
+    public:
+        explicit Buffer(size_t size)
+            : m_data(std::allocator<T>().allocate(size))
+            , m_size(size)
+        {
+        }
+
+        ~Buffer() { std::allocator<T>().deallocate(m_data, m_size); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        void construct(size_t index, T&& value) { new (m_data + index) T(std::move(value)); }
+        void destroy(size_t index) { m_data[index].~T(); }
+        T& operator[](size_t index) { return m_data[index]; }
+
+    private:
+        T* m_data;
+        size_t m_size;
+    };
+
+    //
+    // INFO: Range bucket 'b' holds elements between splitters 'b - 1' and 'b',
+    // equality bucket of splitter 'b' sits between range buckets 'b' and 'b + 1'
+    //
+    size_t bucketIds() const { return 2 * m_buckets - 1; }
+    static bool isEqualityBucket(size_t id) { return (id & 1u) != 0; }
+
+    void buildTree(RandomAccessIterator first, size_t size)
+    {
+        const size_t logBuckets = std::min<size_t>(MaxLogBuckets, 63 - countLeadingZeros(static_cast<uint64_t>(size / (Oversampling * 64))));
+        m_buckets = size_t(1) << std::max<size_t>(1, logBuckets);
+
+        std::mt19937_64 generator(m_options.seed);
+
+        std::vector<T> sample;
+        const size_t sampleSize = Oversampling * m_buckets;
+        sample.reserve(sampleSize);
+        for (size_t i = 0; i < sampleSize; ++i) {
+            sample.push_back(first[static_cast<std::ptrdiff_t>(ServerRandom::uniform<size_t>(0, size - 1, generator))]);
+        }
+        std::sort(sample.begin(), sample.end(), m_compare);
+
+        m_splitters.clear();
+        m_splitters.reserve(m_buckets - 1);
+        for (size_t i = 1; i < m_buckets; ++i) {
+            m_splitters.push_back(sample[i * Oversampling]);
+        }
+
+        //
+        // INFO: Duplicates are replaced by copies of largest splitter, buckets
+        // after it stay empty and all its copies share one equality bucket
+        //
+        auto unique = std::unique(m_splitters.begin(), m_splitters.end(), [this](const T& a, const T& b) {
+            return !m_compare(a, b) && !m_compare(b, a);
+        });
+        std::fill(unique, m_splitters.end(), *(unique - 1));
+
+        m_tree.assign(m_buckets, m_splitters.front());
+        size_t next = 0;
+        fillTree(1, next);
+    }
+
+    void fillTree(size_t node, size_t& next)
+    {
+        if (node >= m_buckets) {
+            return;
+        }
+        fillTree(2 * node, next);
+        m_tree[node] = m_splitters[next++];
+        fillTree(2 * node + 1, next);
+    }
+
+    size_t classify(const T& value) const
+    {
+        size_t node = 1;
+        while (node < m_buckets) {
+            node = 2 * node + static_cast<size_t>(!m_compare(value, m_tree[node]));
+        }
+
+        //
+        // INFO: 'bucket' is number of splitters not greater than value,
+        // value equal to splitter 'bucket - 1' goes to its equality bucket
+        //
+        const size_t bucket = node - m_buckets;
+        const size_t previous = bucket > 0 ? bucket - 1 : 0;
+        const size_t equal = static_cast<size_t>(bucket > 0) & static_cast<size_t>(!m_compare(m_splitters[previous], value));
+        return 2 * bucket - equal;
+    }
+
+    template <typename F>
+    static void parallel(size_t threads, size_t tasks, F&& fn)
+    {
+        std::atomic<size_t> next { 0 };
+        auto worker = [&next, &fn, tasks] {
+            for (size_t task = next.fetch_add(1, std::memory_order_relaxed); task < tasks; task = next.fetch_add(1, std::memory_order_relaxed)) {
+                fn(task);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+
+private:
+    Compare m_compare;
+    SampleSortOptions m_options;
+    size_t m_buckets = 0;
+    std::vector<T> m_splitters;
+    std::vector<T> m_tree;
+};
+
+template <typename RandomAccessIterator, typename Compare = std::less<>>
+void sampleSort(RandomAccessIterator first, RandomAccessIterator last, Compare compare = {}, const SampleSortOptions& options = {})
+{
+    SampleSorter<RandomAccessIterator, Compare>(compare, options).sort(first, last);
+}
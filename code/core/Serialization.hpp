@@ -0,0 +1,344 @@
+#pragma once
+
+#include "ConstexprRandom.hpp"
+#include "FlatHashMap.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// INFO: Wire format of serialized records, every record is
+//
+//   [magic u32][version u32][typeId u64][size u64][payload, padded to 8 bytes]
+//
+// Payload is raw bytes of trivially copyable, pointer-free record type, so
+// buffer (e.g. 'mmap'ed replay file) is read in place, 'SerialRecord::as'
+// returns pointer into it without copy. Format is little-endian, big-endian
+// hosts are not supported. Type ids are FNV-1a hashes of names given in
+// 'ally_serial_type', they don't change between builds and processes
+//
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Serialized records are read in place, little-endian host required.");
+#endif
+
+constexpr uint64_t stableTypeId(std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//
+// INFO: Specialize with 'ally_serial_type', bump version when record layout changes
+//
+template <typename T>
+struct SerialType;
+
+#define ally_serial_type(Type, Name, Version)                        \
+    template <>                                                      \
+    struct SerialType<Type> {                                        \
+        static constexpr std::string_view name = Name;               \
+        static constexpr uint32_t version = Version;                 \
+        static constexpr uint64_t id = stableTypeId(Name);           \
+    }
+
+struct SerialHeader {
+    static constexpr uint32_t Magic = 0x52534c41; // "ALSR"
+    static constexpr size_t Alignment = 8;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t typeId;
+    uint64_t size;
+};
+
+static_assert(sizeof(SerialHeader) % SerialHeader::Alignment == 0, "Payload must stay aligned.");
+
+template <typename T>
+constexpr void checkSerialRecord()
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Record must be trivially copyable.");
+    static_assert(std::is_standard_layout<T>::value, "Record must have standard layout.");
+    static_assert(alignof(T) <= SerialHeader::Alignment, "Record alignment is too big.");
+}
+
+class SerialRecord {
+public:
+    SerialRecord() = default;
+
+    SerialRecord(const SerialHeader* header)
+        : m_header(header)
+    {
+    }
+
+    uint64_t typeId() const { return m_header->typeId; }
+    uint32_t version() const { return m_header->version; }
+    uint64_t size() const { return m_header->size; }
+    const void* payload() const { return m_header + 1; }
+
+    template <typename T>
+    bool is() const
+    {
+        return typeId() == SerialType<T>::id && version() == SerialType<T>::version && size() == sizeof(T);
+    }
+
+    //
+    // INFO: Returns nullptr when type or schema version doesn't match
+    //
+    template <typename T>
+    const T* as() const
+    {
+        checkSerialRecord<T>();
+        return is<T>() ? static_cast<const T*>(payload()) : nullptr;
+    }
+
+private:
+    const SerialHeader* m_header = nullptr;
+};
+
+class SerialWriter {
+public:
+    explicit SerialWriter(std::vector<uint8_t>& out)
+        : m_out(out)
+    {
+    }
+
+    template <typename T>
+    void write(const T& record)
+    {
+        checkSerialRecord<T>();
+        writeRecord(SerialType<T>::id, SerialType<T>::version, &record, sizeof(T));
+    }
+
+    void writeRecord(uint64_t typeId, uint32_t version, const void* payload, size_t size)
+    {
+        const SerialHeader header = { SerialHeader::Magic, version, typeId, size };
+        const size_t padded = (size + SerialHeader::Alignment - 1) & ~(SerialHeader::Alignment - 1);
+
+        const size_t offset = m_out.size();
+        m_out.resize(offset + sizeof(header) + padded, 0);
+        std::memcpy(m_out.data() + offset, &header, sizeof(header));
+        std::memcpy(m_out.data() + offset + sizeof(header), payload, size);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+//
+// INFO: Walks records of buffer in place, buffer must be 8 byte aligned
+// ('mmap' and 'std::vector<uint8_t>' storage are). 'next' returns false at
+// the end or at malformed record, 'isValid' tells which one
+//
+class SerialReader {
+public:
+    SerialReader(const void* data, size_t size)
+        : m_data(static_cast<const uint8_t*>(data))
+        , m_size(size)
+    {
+    }
+
+    bool next(SerialRecord& record)
+    {
+        if (m_offset == m_size || !m_valid) {
+            return false;
+        }
+
+        const auto* header = reinterpret_cast<const SerialHeader*>(m_data + m_offset);
+        const size_t left = m_size - m_offset;
+        if (left < sizeof(SerialHeader) || header->magic != SerialHeader::Magic || header->size > left - sizeof(SerialHeader)) {
+            m_valid = false;
+            return false;
+        }
+
+        const size_t padded = (header->size + SerialHeader::Alignment - 1) & ~(SerialHeader::Alignment - 1);
+        m_offset += sizeof(SerialHeader) + std::min(padded, left - sizeof(SerialHeader));
+        record = SerialRecord(header);
+        return true;
+    }
+
+    bool isValid() const { return m_valid; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_valid = true;
+};
+
+//
+// INFO: Polymorphic serialization of 'Base' hierarchy. Each derived type is
+// stored as its own record type, 'Base' must provide 'uint64_t serialTypeId() const'
+// returning 'SerialType<Record>::id' of dynamic type. Write and read find
+// serializer by type id in one hash lookup, records of other schema version
+// are rejected
+//
+// Usage:
+//   ShipRecord saveShip(const Ship& ship);
+//   std::unique_ptr<Entity> loadShip(const ShipRecord& record);
+//
+//   SerialRegistry<Entity> registry;
+//   registry.add<Ship, ShipRecord, &saveShip, &loadShip>();
+//   registry.write(entity, writer);
+//   std::unique_ptr<Entity> copy = registry.read(record);
+//
+template <typename Base>
+class SerialRegistry {
+public:
+    template <typename Derived, typename Record, Record (*Save)(const Derived&), std::unique_ptr<Base> (*Load)(const Record&)>
+    void add()
+    {
+        checkSerialRecord<Record>();
+        m_entries[SerialType<Record>::id] = { &SerialRegistry::save<Derived, Record, Save>, &SerialRegistry::load<Record, Load> };
+    }
+
+    bool write(const Base& object, SerialWriter& writer) const
+    {
+        auto it = m_entries.find(object.serialTypeId());
+        if (it == m_entries.end()) {
+            return false;
+        }
+        it->second.save(object, writer);
+        return true;
+    }
+
+    std::unique_ptr<Base> read(const SerialRecord& record) const
+    {
+        auto it = m_entries.find(record.typeId());
+        if (it == m_entries.end()) {
+            return nullptr;
+        }
+        return it->second.load(record);
+    }
+
+private:
+    struct Entry {
+        void (*save)(const Base&, SerialWriter&);
+        std::unique_ptr<Base> (*load)(const SerialRecord&);
+    };
+
+    template <typename Derived, typename Record, Record (*Save)(const Derived&)>
+    static void save(const Base& object, SerialWriter& writer)
+    {
+        writer.write(Save(static_cast<const Derived&>(object)));
+    }
+
+    template <typename Record, std::unique_ptr<Base> (*Load)(const Record&)>
+    static std::unique_ptr<Base> load(const SerialRecord& record)
+    {
+        const Record* payload = record.as<Record>();
+        return payload ? Load(*payload) : nullptr;
+    }
+
+private:
+    FlatHashMap<uint64_t, Entry> m_entries;
+};
+
+//
+// INFO: Generator state as record, so 'RandomBase' traits generators can be
+// saved with replays and snapshots. Standard engines are stored as words of
+// their standard text state, 'Pcg32' and 'SplitMix64' as raw state
+//
+// Usage:
+//   writer.write(saveGenerator(ServerRandomTraits::generator()));
+//   loadGenerator(*record.as<GeneratorState<std::mt19937_64>>(), ServerRandomTraits::generator());
+//
+template <typename Engine>
+struct GeneratorStateTraits;
+
+template <typename UInt, size_t W, size_t N, size_t M, size_t R, UInt A, size_t U, UInt D, size_t S, UInt B, size_t T, UInt C, size_t L, UInt F>
+struct GeneratorStateTraits<std::mersenne_twister_engine<UInt, W, N, M, R, A, U, D, S, B, T, C, L, F>> {
+    //
+    // INFO: State words and position, some standard libraries write only words
+    //
+    static constexpr size_t words = N + 1;
+    static constexpr bool text = true;
+};
+
+template <typename UInt, UInt A, UInt C, UInt M>
+struct GeneratorStateTraits<std::linear_congruential_engine<UInt, A, C, M>> {
+    static constexpr size_t words = 1;
+    static constexpr bool text = true;
+};
+
+template <>
+struct GeneratorStateTraits<Pcg32> {
+    static constexpr size_t words = 2;
+    static constexpr bool text = false;
+};
+
+template <>
+struct GeneratorStateTraits<SplitMix64> {
+    static constexpr size_t words = 1;
+    static constexpr bool text = false;
+};
+
+template <typename Engine>
+struct GeneratorState {
+    uint64_t count;
+    uint64_t words[GeneratorStateTraits<Engine>::words];
+};
+
+ally_serial_type(GeneratorState<std::mt19937>, "GeneratorState<mt19937>", 1);
+ally_serial_type(GeneratorState<std::mt19937_64>, "GeneratorState<mt19937_64>", 1);
+ally_serial_type(GeneratorState<std::minstd_rand>, "GeneratorState<minstd_rand>", 1);
+ally_serial_type(GeneratorState<Pcg32>, "GeneratorState<Pcg32>", 1);
+ally_serial_type(GeneratorState<SplitMix64>, "GeneratorState<SplitMix64>", 1);
+
+template <typename Engine>
+GeneratorState<Engine> saveGenerator(const Engine& engine)
+{
+    using Traits = GeneratorStateTraits<Engine>;
+
+    GeneratorState<Engine> state = {};
+    if constexpr (Traits::text) {
+        std::stringstream stream;
+        stream << engine;
+        while (state.count < Traits::words && stream >> state.words[state.count]) {
+            ++state.count;
+        }
+    } else {
+        static_assert(sizeof(Engine) == sizeof(state.words), "Raw state must fill record.");
+        std::memcpy(state.words, &engine, sizeof(Engine));
+        state.count = Traits::words;
+    }
+    return state;
+}
+
+//
+// INFO: Returns false and leaves 'engine' unchanged when state is malformed
+//
+template <typename Engine>
+bool loadGenerator(const GeneratorState<Engine>& state, Engine& engine)
+{
+    using Traits = GeneratorStateTraits<Engine>;
+
+    if (state.count == 0 || state.count > Traits::words) {
+        return false;
+    }
+
+    if constexpr (Traits::text) {
+        std::stringstream stream;
+        for (uint64_t i = 0; i < state.count; ++i) {
+            stream << state.words[i] << ' ';
+        }
+
+        Engine loaded;
+        if (!(stream >> loaded)) {
+            return false;
+        }
+        engine = loaded;
+    } else {
+        std::memcpy(&engine, state.words, sizeof(Engine));
+    }
+    return true;
+}
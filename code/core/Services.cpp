@@ -1,4 +1,24 @@
 #include "Services.hpp"
+#include "FlatHashMap.hpp"
+#include <mutex>
+#include <string>
+
+ServiceKey ServiceKey::intern(std::string_view name)
+{
+    static std::mutex s_mutex;
+    static FlatHashMap<std::string, uint32_t> s_keys;
+
+    //
+    // INFO: Empty name is default key, named keys start from 1
+    //
+    if (name.empty()) {
+        return ServiceKey();
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_keys.try_emplace(std::string(name), static_cast<uint32_t>(s_keys.size() + 1)).first;
+    return ServiceKey(it->second);
+}
 
 Services& services()
 {
@@ -1,42 +1,179 @@
 #pragma once
 
 #include "TypeIndex.hpp"
+#include "TypeHierarchy.hpp"
 #include "Assertions.hpp"
-#include <map>
+#include <cstdint>
 #include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+//
+// INFO: Small integer that names one of many instances of service type,
+// e.g. DB pool per shard. Intern names once at startup and keep keys,
+// lookup by key never touches strings. Default key is unnamed instance
+//
+class ServiceKey {
+public:
+    constexpr ServiceKey() = default;
+
+    static ServiceKey intern(std::string_view name);
+
+    constexpr uint32_t value() const { return m_value; }
+
+    constexpr bool operator==(ServiceKey other) const { return m_value == other.m_value; }
+    constexpr bool operator!=(ServiceKey other) const { return m_value != other.m_value; }
+
+private:
+    constexpr explicit ServiceKey(uint32_t value)
+        : m_value(value)
+    {
+    }
+
+private:
+    uint32_t m_value = 0;
+};
+
+//
+// INFO: Services are stored in dense table indexed by
+// 'orderedTypeIndex<Services, T>' and key, lookup is two loads. Every slot
+// remembers dynamic type of service, 'viewService' checks it against
+// 'TypeHierarchy<Services>' filled by 'emplaceService', two compares
+//
 class Services {
 public:
     template <typename Derived, typename Base, typename... Args>
-    void emplaceService(Args&&... args)
+    bool emplaceService(Args&&... args)
+    {
+        return emplaceService<Derived, Base>(ServiceKey(), std::forward<Args>(args)...);
+    }
+
+    //
+    // INFO: First registration wins, returns false and constructs nothing
+    // when 'Base' or 'Derived' is already registered under 'key'
+    //
+    template <typename Derived, typename Base, typename... Args>
+    bool emplaceService(ServiceKey key, Args&&... args)
     {
-        auto baseIndex = unorderedTypeIndex<Services, Base>();
-        auto derivedIndex = unorderedTypeIndex<Services, Derived>();
+        static_assert(std::is_same<Base, Derived>::value || std::is_base_of<Base, Derived>::value, "Service must derive from its base.");
+
+        if (hasService(orderedTypeIndex<Services, Base>(), key) || hasService(orderedTypeIndex<Services, Derived>(), key)) {
+            return false;
+        }
 
-        std::shared_ptr<void> newService(new Derived(std::forward(args)...));
-        m_services.insert({ baseIndex, newService });
-        m_services.insert({ derivedIndex, newService });
+        //
+        // INFO: Base slot points to 'Base' subobject, with multiple
+        // inheritance it doesn't have the address of 'Derived'
+        //
+        std::shared_ptr<Derived> newService(new Derived(std::forward<Args>(args)...));
+        TypeIndex dynamicType = hierarchyIndexOf<Services, Derived>();
+        if constexpr (!std::is_same<Derived, Base>::value) {
+            if (!TypeHierarchy<Services>::instance().template add<Derived, Base>()) {
+                dynamicType = hierarchyIndexOf<Services, Base>();
+            }
+        }
+
+        insert(orderedTypeIndex<Services, Base>(), key, { std::shared_ptr<void>(newService, static_cast<Base*>(newService.get())), dynamicType });
+        if (!std::is_same<Derived, Base>::value) {
+            insert(orderedTypeIndex<Services, Derived>(), key, { newService, hierarchyIndexOf<Services, Derived>() });
+        }
 
         m_totalSizeInBytes += sizeof(Derived);
+        return true;
+    }
+
+    //
+    // INFO: Registers or replaces service owned elsewhere, e.g. by shared memory mapping.
+    // 'attachService<const T>' registers read-only service, it is found only
+    // by 'viewService<const T>', so no caller gets mutable pointer to it
+    //
+    template <typename T>
+    void attachService(std::shared_ptr<T> service, ServiceKey key = ServiceKey())
+    {
+        using MutableType = std::remove_const_t<T>;
+        slot(orderedTypeIndex<Services, T>(), key) = { std::const_pointer_cast<MutableType>(std::move(service)), hierarchyIndexOf<Services, T>() };
     }
 
     template <typename T>
-    T* viewService()
+    T* viewService(ServiceKey key = ServiceKey())
+    {
+        //
+        // INFO: No 'ally_assert' here, in assume mode it would delete the check,
+        // callers rely on nullptr for missing service
+        //
+        auto index = orderedTypeIndex<Services, T>();
+        if (!hasService(index, key)) {
+            return nullptr;
+        }
+
+        const auto& registered = m_services[index][key.value()];
+        ally_assert(TypeHierarchy<Services>::instance().template isA<T>(registered.type), "service doesn't derive from requested type");
+        return static_cast<T*>(registered.service.get());
+    }
+
+    //
+    // INFO: Pointer that shares ownership of service, it stays valid after
+    // service is replaced by 'attachService', e.g. on 'SharedServices::refresh'
+    //
+    template <typename T>
+    std::shared_ptr<T> pinService(ServiceKey key = ServiceKey())
+    {
+        T* service = viewService<T>(key);
+        if (!service) {
+            return nullptr;
+        }
+        return std::shared_ptr<T>(m_services[orderedTypeIndex<Services, T>()][key.value()].service, service);
+    }
+
+    template <typename T>
+    bool hasService(ServiceKey key = ServiceKey()) const
+    {
+        return hasService(orderedTypeIndex<Services, T>(), key);
+    }
+
+private:
+    struct Slot {
+        std::shared_ptr<void> service;
+        TypeIndex type = 0;
+    };
+
+    bool hasService(TypeIndex index, ServiceKey key) const
+    {
+        return index < m_services.size() && key.value() < m_services[index].size() && m_services[index][key.value()].service;
+    }
+
+    Slot& slot(TypeIndex index, ServiceKey key)
+    {
+        if (index >= m_services.size()) {
+            m_services.resize(index + 1);
+        }
+
+        auto& instances = m_services[index];
+        if (key.value() >= instances.size()) {
+            instances.resize(key.value() + 1);
+        }
+        return instances[key.value()];
+    }
+
+    void insert(TypeIndex index, ServiceKey key, Slot service)
     {
-        auto index = unorderedTypeIndex<Services, T>();
-        ally_assert(m_services.find(index) != m_services.end(), "access to non-existing service");
-        return static_cast<T*>(m_services[index].get());
+        auto& registered = slot(index, key);
+        if (!registered.service) {
+            registered = std::move(service);
+        }
     }
 
 private:
-    std::map<TypeIndex, std::shared_ptr<void>> m_services;
+    std::vector<std::vector<Slot>> m_services;
     int m_totalSizeInBytes = 0;
 };
 
 Services& services();
 
 template <typename T>
-T* service()
+T* service(ServiceKey key = ServiceKey())
 {
-    return services().viewService<T>();
+    return services().viewService<T>(key);
 }
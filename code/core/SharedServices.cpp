@@ -0,0 +1,361 @@
+#include "SharedServices.hpp"
+#include "Hash.hpp"
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ALLY_SHARED_MEMORY 1
+#endif
+
+namespace {
+constexpr uint32_t SegmentMagic = 0x53534c41; // "ALSS"
+constexpr uint32_t SegmentVersion = 1;
+constexpr int MaxMapAttempts = 8;
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;
+    uint64_t size;
+    uint64_t entryCount;
+    uint64_t entriesOffset;
+};
+
+struct SegmentEntry {
+    uint64_t nameHash;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t alignment;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Generation counter is shared between processes.");
+
+//
+// INFO: Explicit seed, name hash must be the same in every process
+//
+uint64_t serviceNameHash(std::string_view name)
+{
+    return hashBytes(name.data(), name.size(), 0);
+}
+
+std::string generationName(const std::string& name, uint64_t generation)
+{
+    return name + "." + std::to_string(generation);
+}
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#if ALLY_SHARED_MEMORY
+std::shared_ptr<const void> mapShared(const std::string& name, size_t minimumSize)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < minimumSize) {
+        close(fd);
+        return nullptr;
+    }
+
+    const auto size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    return std::shared_ptr<const void>(data, [size](const void* mapped) {
+        munmap(const_cast<void*>(mapped), size);
+    });
+}
+#endif
+}
+
+//
+// SharedServicesWriter
+//
+
+SharedServicesWriter::SharedServicesWriter(std::string name, size_t capacity)
+    : m_name(std::move(name))
+    , m_capacity(capacity)
+{
+#if ALLY_SHARED_MEMORY
+    const int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        return;
+    }
+
+    const bool sized = ftruncate(fd, sizeof(std::atomic<uint64_t>)) == 0;
+    void* control = sized ? mmap(nullptr, sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (control == MAP_FAILED) {
+        return;
+    }
+
+    //
+    // INFO: New segment is zero filled, that is generation 0, nothing published
+    //
+    m_control = static_cast<std::atomic<uint64_t>*>(control);
+    m_generation = m_control->load(std::memory_order_acquire);
+    beginGeneration();
+#endif
+}
+
+SharedServicesWriter::~SharedServicesWriter()
+{
+#if ALLY_SHARED_MEMORY
+    if (m_data) {
+        unmapData();
+        shm_unlink(generationName(m_name, m_generation + 1).c_str());
+    }
+    if (m_control) {
+        munmap(m_control, sizeof(std::atomic<uint64_t>));
+    }
+#endif
+}
+
+void* SharedServicesWriter::allocate(size_t bytes, size_t alignment)
+{
+    ally_assert(m_data, "shared segment isn't mapped");
+
+    const size_t offset = alignUp(m_used, alignment);
+    if (offset + bytes > m_capacity) {
+        m_overflow = true;
+        return nullptr;
+    }
+
+    m_used = offset + bytes;
+    return m_data + offset;
+}
+
+void SharedServicesWriter::publishBytes(std::string_view serviceName, const void* service, size_t size, size_t alignment)
+{
+    ally_assert(service == nullptr || (service >= m_data && service < m_data + m_used), "service must be created by this writer");
+
+    if (!service) {
+        m_overflow = true;
+        return;
+    }
+
+    const auto offset = static_cast<uint64_t>(static_cast<const uint8_t*>(service) - m_data);
+    m_entries.push_back({ serviceNameHash(serviceName), offset, static_cast<uint32_t>(size), static_cast<uint32_t>(alignment) });
+}
+
+bool SharedServicesWriter::commit()
+{
+#if ALLY_SHARED_MEMORY
+    if (!m_data) {
+        return false;
+    }
+
+    auto* entries = static_cast<SegmentEntry*>(allocate(sizeof(SegmentEntry) * m_entries.size(), alignof(SegmentEntry)));
+    if (m_overflow) {
+        unmapData();
+        shm_unlink(generationName(m_name, m_generation + 1).c_str());
+        beginGeneration();
+        return false;
+    }
+
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        entries[i] = { m_entries[i].nameHash, m_entries[i].offset, m_entries[i].size, m_entries[i].alignment };
+    }
+
+    const uint64_t generation = m_generation + 1;
+
+    SegmentHeader header;
+    header.magic = SegmentMagic;
+    header.version = SegmentVersion;
+    header.generation = generation;
+    header.size = m_capacity;
+    header.entryCount = m_entries.size();
+    header.entriesOffset = static_cast<uint64_t>(reinterpret_cast<uint8_t*>(entries) - m_data);
+    std::memcpy(m_data, &header, sizeof(header));
+
+    unmapData();
+    m_control->store(generation, std::memory_order_release);
+
+    //
+    // INFO: Readers that mapped previous generation keep it until they unmap,
+    // name is removed so new readers can't open it
+    //
+    shm_unlink(generationName(m_name, m_generation).c_str());
+
+    m_generation = generation;
+    return beginGeneration();
+#else
+    return false;
+#endif
+}
+
+bool SharedServicesWriter::beginGeneration()
+{
+#if ALLY_SHARED_MEMORY
+    m_used = sizeof(SegmentHeader);
+    m_overflow = false;
+    m_entries.clear();
+
+    const std::string segmentName = generationName(m_name, m_generation + 1);
+    shm_unlink(segmentName.c_str());
+
+    const int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) {
+        return false;
+    }
+
+    const bool sized = ftruncate(fd, static_cast<off_t>(m_capacity)) == 0;
+    void* data = sized ? mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(segmentName.c_str());
+        return false;
+    }
+
+    m_data = static_cast<uint8_t*>(data);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SharedServicesWriter::remove(const std::string& name)
+{
+#if ALLY_SHARED_MEMORY
+    if (auto control = mapShared(name, sizeof(std::atomic<uint64_t>))) {
+        const uint64_t generation = static_cast<const std::atomic<uint64_t>*>(control.get())->load(std::memory_order_acquire);
+        shm_unlink(generationName(name, generation).c_str());
+    }
+    shm_unlink(name.c_str());
+#else
+    static_cast<void>(name);
+#endif
+}
+
+void SharedServicesWriter::unmapData()
+{
+#if ALLY_SHARED_MEMORY
+    munmap(m_data, m_capacity);
+#endif
+    m_data = nullptr;
+}
+
+//
+// SharedServices
+//
+
+SharedServices::SharedServices(std::string name, Services& target)
+    : m_name(std::move(name))
+    , m_target(target)
+{
+#if ALLY_SHARED_MEMORY
+    m_control = mapShared(m_name, sizeof(std::atomic<uint64_t>));
+    if (m_control) {
+        mapLatest();
+    }
+#endif
+}
+
+uint64_t SharedServices::generation() const
+{
+    if (!m_mapping) {
+        return 0;
+    }
+    return static_cast<const SegmentHeader*>(m_mapping.get())->generation;
+}
+
+bool SharedServices::attachBytes(std::string_view serviceName, size_t size, size_t alignment, Resolve resolve)
+{
+    m_attached.push_back({ std::string(serviceName), size, alignment, resolve });
+    return resolveAttached(m_attached.back());
+}
+
+bool SharedServices::resolveAttached(const Attached& attached) const
+{
+    if (!m_mapping) {
+        return false;
+    }
+
+    const auto* base = static_cast<const uint8_t*>(m_mapping.get());
+    const auto* header = static_cast<const SegmentHeader*>(m_mapping.get());
+    const auto* entries = reinterpret_cast<const SegmentEntry*>(base + header->entriesOffset);
+
+    const uint64_t nameHash = serviceNameHash(attached.name);
+    for (uint64_t i = 0; i < header->entryCount; ++i) {
+        const SegmentEntry& entry = entries[i];
+        if (entry.nameHash != nameHash) {
+            continue;
+        }
+
+        if (entry.size != attached.size || entry.alignment != attached.alignment) {
+            return false;
+        }
+
+        attached.resolve(m_target, m_mapping, base + entry.offset);
+        return true;
+    }
+
+    return false;
+}
+
+bool SharedServices::refresh()
+{
+    if (!m_control) {
+        return false;
+    }
+
+    const auto* control = static_cast<const std::atomic<uint64_t>*>(m_control.get());
+    if (control->load(std::memory_order_acquire) == generation()) {
+        return false;
+    }
+
+    if (!mapLatest()) {
+        return false;
+    }
+
+    for (const Attached& attached : m_attached) {
+        resolveAttached(attached);
+    }
+    return true;
+}
+
+bool SharedServices::mapLatest()
+{
+#if ALLY_SHARED_MEMORY
+    const auto* control = static_cast<const std::atomic<uint64_t>*>(m_control.get());
+
+    //
+    // INFO: Writer may commit and unlink generation between our load and open,
+    // then we load again and open the newer one
+    //
+    for (int attempt = 0; attempt < MaxMapAttempts; ++attempt) {
+        const uint64_t latest = control->load(std::memory_order_acquire);
+        if (latest == 0) {
+            return false;
+        }
+
+        auto mapping = mapShared(generationName(m_name, latest), sizeof(SegmentHeader));
+        if (!mapping) {
+            continue;
+        }
+
+        const auto* header = static_cast<const SegmentHeader*>(mapping.get());
+        const bool valid = header->magic == SegmentMagic && header->version == SegmentVersion
+            && header->generation == latest
+            && header->entriesOffset + header->entryCount * sizeof(SegmentEntry) <= header->size;
+        if (!valid) {
+            return false;
+        }
+
+        m_mapping = std::move(mapping);
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Services.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// INFO: Pointer stored as distance from its own address, it stays valid when
+// shared memory segment is mapped at different address in every process.
+// Null is zero distance, so pointer can't point to itself
+//
+template <typename T>
+class OffsetPtr {
+public:
+    OffsetPtr() = default;
+    OffsetPtr(T* pointer) { set(pointer); }
+
+    OffsetPtr(const OffsetPtr&) = delete;
+    OffsetPtr& operator=(const OffsetPtr&) = delete;
+
+    OffsetPtr& operator=(T* pointer)
+    {
+        set(pointer);
+        return *this;
+    }
+
+    T* get() const
+    {
+        if (m_offset == 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + m_offset);
+    }
+
+    T* operator->() const { return get(); }
+    T& operator*() const { return *get(); }
+    T& operator[](size_t index) const { return get()[index]; }
+    explicit operator bool() const { return m_offset != 0; }
+
+private:
+    void set(T* pointer)
+    {
+        m_offset = pointer ? reinterpret_cast<intptr_t>(pointer) - reinterpret_cast<intptr_t>(this) : 0;
+    }
+
+private:
+    int64_t m_offset = 0;
+};
+
+//
+// INFO: Array in shared segment, 'SharedServicesWriter::allocateArray' fills it
+//
+template <typename T>
+struct SharedArray {
+    OffsetPtr<T> data;
+    uint64_t size = 0;
+
+    T* begin() const { return data.get(); }
+    T* end() const { return data.get() + size; }
+    T& operator[](size_t index) const { return data[index]; }
+};
+
+//
+// INFO: Publishes read-only services into POSIX shared memory, one writer per
+// segment name. Services are built in place inside the segment, they must not
+// hold raw pointers or own heap memory: use plain data, 'OffsetPtr' and 'SharedArray'.
+//
+// Every 'commit' publishes new generation '<name>.<generation>', readers switch
+// to it on 'SharedServices::refresh', old generation stays mapped until last
+// 'Services' slot or pinned pointer drops it
+//
+// Usage:
+//   SharedServicesWriter writer("/ally.world", 512 << 20);
+//   auto* navmesh = writer.create<NavMesh>();
+//   writer.allocateArray(navmesh->polygons, polygonCount);
+//   writer.publish("NavMesh", navmesh);
+//   writer.commit();
+//
+class SharedServicesWriter {
+public:
+    SharedServicesWriter(std::string name, size_t capacity);
+    ~SharedServicesWriter();
+
+    SharedServicesWriter(const SharedServicesWriter&) = delete;
+    SharedServicesWriter& operator=(const SharedServicesWriter&) = delete;
+
+    bool isValid() const { return m_data != nullptr; }
+
+    //
+    // INFO: Returns nullptr when segment capacity is exhausted
+    //
+    void* allocate(size_t bytes, size_t alignment);
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Shared services are never destroyed.");
+
+        void* memory = allocate(sizeof(T), alignof(T));
+        return memory ? new (memory) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    template <typename T>
+    T* allocateArray(SharedArray<T>& array, size_t size)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Shared services are never destroyed.");
+
+        T* data = static_cast<T*>(allocate(sizeof(T) * size, alignof(T)));
+        if (data) {
+            for (size_t i = 0; i < size; ++i) {
+                new (data + i) T();
+            }
+            array.data = data;
+            array.size = size;
+        }
+        return data;
+    }
+
+    template <typename T>
+    void publish(std::string_view serviceName, const T* service)
+    {
+        publishBytes(serviceName, service, sizeof(T), alignof(T));
+    }
+
+    //
+    // INFO: Makes published services visible to readers and starts next generation,
+    // returns false when segment overflowed
+    //
+    bool commit();
+
+    uint64_t generation() const { return m_generation; }
+
+    //
+    // INFO: Removes segment names, mapped generations stay valid for their readers
+    //
+    static void remove(const std::string& name);
+
+private:
+    void publishBytes(std::string_view serviceName, const void* service, size_t size, size_t alignment);
+    bool beginGeneration();
+    void unmapData();
+
+private:
+    struct Entry {
+        uint64_t nameHash;
+        uint64_t offset;
+        uint32_t size;
+        uint32_t alignment;
+    };
+
+    std::string m_name;
+    size_t m_capacity;
+    std::atomic<uint64_t>* m_control = nullptr;
+    uint8_t* m_data = nullptr;
+    size_t m_used = 0;
+    bool m_overflow = false;
+    uint64_t m_generation = 0;
+    std::vector<Entry> m_entries;
+};
+
+//
+// INFO: Reader side, maps latest generation read-only and attaches requested
+// services to 'Services' as 'const T', so 'service<const T>()' returns pointer
+// into shared memory. Mapping is released when 'Services' and this object drop it
+//
+// 'refresh' replaces attached services, raw pointers from 'service<const T>()'
+// are valid only until next 'refresh'. Code that keeps service across it holds
+// 'pinService<const T>()', it keeps its generation mapped
+//
+// Usage:
+//   SharedServices shared("/ally.world");
+//   shared.attach<NavMesh>("NavMesh");
+//   const NavMesh* navmesh = service<const NavMesh>();
+//   std::shared_ptr<const NavMesh> pinned = services().pinService<const NavMesh>();
+//
+class SharedServices {
+public:
+    explicit SharedServices(std::string name, Services& target = services());
+
+    bool isValid() const { return m_mapping != nullptr; }
+    uint64_t generation() const;
+
+    //
+    // INFO: Returns false when service is missing or its layout doesn't match
+    //
+    template <typename T>
+    bool attach(std::string_view serviceName)
+    {
+        auto resolve = [](Services& target, const std::shared_ptr<const void>& mapping, const void* service) {
+            target.attachService<const T>(std::shared_ptr<const T>(mapping, static_cast<const T*>(service)));
+        };
+        return attachBytes(serviceName, sizeof(T), alignof(T), resolve);
+    }
+
+    //
+    // INFO: Maps newer generation if writer committed one and re-attaches
+    // all services, returns true when generation changed. 'Services' isn't
+    // thread safe, call it where no other thread reads target services
+    //
+    bool refresh();
+
+private:
+    using Resolve = void (*)(Services&, const std::shared_ptr<const void>&, const void*);
+
+    struct Attached {
+        std::string name;
+        size_t size;
+        size_t alignment;
+        Resolve resolve;
+    };
+
+    bool attachBytes(std::string_view serviceName, size_t size, size_t alignment, Resolve resolve);
+    bool resolveAttached(const Attached& attached) const;
+    bool mapLatest();
+
+private:
+    std::string m_name;
+    Services& m_target;
+    std::shared_ptr<const void> m_control;
+    std::shared_ptr<const void> m_mapping;
+    std::vector<Attached> m_attached;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ConstexprRandom.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//
+// INFO: Eight independent xoshiro128++ generators stepped together, one call
+// gives eight 32-bit values. With AVX2 lanes live in one register, otherwise
+// the same algorithm runs lane by lane, output is identical for the same seed.
+// Lanes are seeded from 'SplitMix64', so nearby seeds give unrelated streams
+//
+// https://prng.di.unimi.it/xoshiro128plusplus.c
+//
+class Xoshiro128x8 {
+public:
+    static constexpr size_t Lanes = 8;
+
+    explicit Xoshiro128x8(uint64_t seed = 0x2545f4914f6cdd1dull) { this->seed(seed); }
+
+    void seed(uint64_t seedValue)
+    {
+        SplitMix64 mixer(seedValue);
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            const uint64_t low = mixer();
+            const uint64_t high = mixer();
+            m_state[0][lane] = static_cast<uint32_t>(low);
+            m_state[1][lane] = static_cast<uint32_t>(low >> 32u);
+            m_state[2][lane] = static_cast<uint32_t>(high);
+            m_state[3][lane] = static_cast<uint32_t>(high >> 32u) | 1u;
+        }
+    }
+
+    void next(uint32_t* out)
+    {
+#if defined(__AVX2__)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), nextVector());
+#else
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            uint32_t& s0 = m_state[0][lane];
+            uint32_t& s1 = m_state[1][lane];
+            uint32_t& s2 = m_state[2][lane];
+            uint32_t& s3 = m_state[3][lane];
+
+            out[lane] = rotate(s0 + s3, 7) + s0;
+
+            const uint32_t t = s1 << 9u;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = rotate(s3, 11);
+        }
+#endif
+    }
+
+#if defined(__AVX2__)
+    __m256i nextVector()
+    {
+        __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[0]));
+        __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[1]));
+        __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[2]));
+        __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_state[3]));
+
+        const __m256i result = _mm256_add_epi32(rotate(_mm256_add_epi32(s0, s3), 7), s0);
+
+        const __m256i t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = rotate(s3, 11);
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[0]), s0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[1]), s1);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[2]), s2);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(m_state[3]), s3);
+        return result;
+    }
+#endif
+
+private:
+    static uint32_t rotate(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+#if defined(__AVX2__)
+    static __m256i rotate(__m256i value, int bits)
+    {
+        return _mm256_or_si256(_mm256_slli_epi32(value, bits), _mm256_srli_epi32(value, 32 - bits));
+    }
+#endif
+
+private:
+    alignas(32) uint32_t m_state[4][Lanes];
+};
@@ -0,0 +1,728 @@
+#include "Sketches.hpp"
+#include "Assertions.hpp"
+#include "Bits.hpp"
+#include "Random.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr uint32_t SketchMagic = 0x4b534c41; // "ALSK"
+constexpr uint8_t SketchVersion = 1;
+
+enum class SketchKind : uint8_t {
+    HyperLogLog = 1,
+    CountMin = 2,
+    BlockedBloom = 3,
+    Cuckoo = 4
+};
+
+class SketchWriter {
+public:
+    explicit SketchWriter(std::vector<uint8_t>& out)
+        : m_out(out)
+    {
+    }
+
+    void header(SketchKind kind, uint64_t seed)
+    {
+        u32(SketchMagic);
+        u8(static_cast<uint8_t>(kind));
+        u8(SketchVersion);
+        u64(seed);
+    }
+
+    void u8(uint8_t value) { m_out.push_back(value); }
+    void u16(uint16_t value) { bytes(value, 2); }
+    void u32(uint32_t value) { bytes(value, 4); }
+    void u64(uint64_t value) { bytes(value, 8); }
+
+private:
+    void bytes(uint64_t value, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            m_out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+class SketchReader {
+public:
+    SketchReader(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_left(size)
+    {
+    }
+
+    bool header(SketchKind kind, uint64_t& seed)
+    {
+        uint32_t magic = 0;
+        uint8_t storedKind = 0;
+        uint8_t version = 0;
+        return u32(magic) && u8(storedKind) && u8(version) && u64(seed)
+            && magic == SketchMagic && storedKind == static_cast<uint8_t>(kind) && version == SketchVersion;
+    }
+
+    bool u8(uint8_t& value) { return bytes(value, 1); }
+    bool u16(uint16_t& value) { return bytes(value, 2); }
+    bool u32(uint32_t& value) { return bytes(value, 4); }
+    bool u64(uint64_t& value) { return bytes(value, 8); }
+
+    size_t left() const { return m_left; }
+
+private:
+    template <typename T>
+    bool bytes(T& value, size_t count)
+    {
+        if (m_left < count) {
+            return false;
+        }
+
+        uint64_t result = 0;
+        for (size_t i = 0; i < count; ++i) {
+            result |= static_cast<uint64_t>(m_data[i]) << (8 * i);
+        }
+        value = static_cast<T>(result);
+
+        m_data += count;
+        m_left -= count;
+        return true;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_left;
+};
+
+//
+// INFO: Index into power of two table and second hash for double hashing
+//
+uint64_t secondHash(uint64_t hash)
+{
+    return mixHash(hash, 0x5bd1e9955bd1e995ull) | 1u;
+}
+}
+
+uint64_t sketchSeed(std::string_view family)
+{
+    return hashBytes(family.data(), family.size(), ServerRandomTraits::seed());
+}
+
+//
+// HyperLogLog
+//
+
+HyperLogLog::HyperLogLog(int precision, uint64_t seed)
+    : m_precision(std::min(std::max(precision, MinPrecision), MaxPrecision))
+    , m_seed(seed)
+    , m_registers(size_t(1) << m_precision, 0)
+{
+}
+
+void HyperLogLog::addHash(uint64_t hash)
+{
+    const int p = m_precision;
+    const size_t index = static_cast<size_t>(hash >> (64 - p));
+
+    //
+    // INFO: Guard bit keeps rank within '64 - p + 1' and input of clz non-zero
+    //
+    const uint64_t rest = (hash << p) | (uint64_t(1) << (p - 1));
+    const auto rank = static_cast<uint8_t>(countLeadingZeros(rest) + 1);
+
+    uint8_t& value = m_registers[index];
+    value = std::max(value, rank);
+}
+
+void HyperLogLog::addHashes(const uint64_t* hashes, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        addHash(hashes[i]);
+    }
+}
+
+double HyperLogLog::estimate() const
+{
+    //
+    // INFO: Improved raw estimator from Otmar Ertl, "New cardinality estimation
+    // algorithms for HyperLogLog sketches" (2017), accurate over whole range
+    // without HLL++ empirical bias tables
+    //
+    const int q = 64 - m_precision;
+    const double m = static_cast<double>(m_registers.size());
+
+    std::vector<double> histogram(static_cast<size_t>(q + 2), 0.0);
+    for (uint8_t value : m_registers) {
+        histogram[value] += 1.0;
+    }
+
+    auto sigma = [](double x) {
+        if (x == 1.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double y = 1.0;
+        double z = x;
+        double previous = 0.0;
+        do {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        } while (previous != z);
+        return z;
+    };
+
+    auto tau = [](double x) {
+        if (x == 0.0 || x == 1.0) {
+            return 0.0;
+        }
+        double y = 1.0;
+        double z = 1.0 - x;
+        double previous = 0.0;
+        do {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= (1.0 - x) * (1.0 - x) * y;
+        } while (previous != z);
+        return z / 3.0;
+    };
+
+    double z = m * tau(1.0 - histogram[static_cast<size_t>(q + 1)] / m);
+    for (int k = q; k >= 1; --k) {
+        z = 0.5 * (z + histogram[static_cast<size_t>(k)]);
+    }
+    z += m * sigma(histogram[0] / m);
+
+    const double alphaInfinity = 0.5 / std::log(2.0);
+    return alphaInfinity * m * m / z;
+}
+
+bool HyperLogLog::merge(const HyperLogLog& other)
+{
+    if (other.m_precision != m_precision || other.m_seed != m_seed) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_registers.size(); ++i) {
+        m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+    }
+    return true;
+}
+
+void HyperLogLog::clear()
+{
+    std::fill(m_registers.begin(), m_registers.end(), uint8_t(0));
+}
+
+void HyperLogLog::serialize(std::vector<uint8_t>& out) const
+{
+    SketchWriter writer(out);
+    writer.header(SketchKind::HyperLogLog, m_seed);
+    writer.u8(static_cast<uint8_t>(m_precision));
+
+    //
+    // INFO: Register never exceeds 61, six bits per register are enough
+    //
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (uint8_t value : m_registers) {
+        buffer |= static_cast<uint32_t>(value) << bits;
+        bits += 6;
+        while (bits >= 8) {
+            writer.u8(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        writer.u8(static_cast<uint8_t>(buffer));
+    }
+}
+
+bool HyperLogLog::deserialize(const uint8_t* data, size_t size)
+{
+    SketchReader reader(data, size);
+
+    uint64_t seed = 0;
+    uint8_t precision = 0;
+    if (!reader.header(SketchKind::HyperLogLog, seed) || !reader.u8(precision) || precision < MinPrecision || precision > MaxPrecision) {
+        return false;
+    }
+
+    const size_t count = size_t(1) << precision;
+    if (reader.left() < (count * 6 + 7) / 8) {
+        return false;
+    }
+
+    //
+    // INFO: Register holds rank of first set bit, at most '64 - precision + 1',
+    // larger value from corrupted blob would index past rank histogram
+    //
+    const int maxRank = 64 - precision + 1;
+
+    std::vector<uint8_t> registers(count);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (auto& value : registers) {
+        while (bits < 6) {
+            uint8_t byte = 0;
+            reader.u8(byte);
+            buffer |= static_cast<uint32_t>(byte) << bits;
+            bits += 8;
+        }
+        value = static_cast<uint8_t>(buffer & 0x3f);
+        buffer >>= 6;
+        bits -= 6;
+
+        if (value > maxRank) {
+            return false;
+        }
+    }
+
+    m_precision = precision;
+    m_seed = seed;
+    m_registers = std::move(registers);
+    return true;
+}
+
+//
+// CountMinSketch
+//
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth, uint64_t seed)
+    : m_width(static_cast<size_t>(roundUpToPowerOfTwo(width)))
+    , m_depth(std::min(std::max<size_t>(depth, 1), MaxDepth))
+    , m_seed(seed)
+    , m_counters(m_width * m_depth, 0)
+{
+}
+
+void CountMinSketch::indices(uint64_t hash, size_t* out) const
+{
+    //
+    // INFO: Kirsch-Mitzenmacher double hashing, one hash for every row,
+    // loop has no dependencies and vectorizes
+    //
+    const uint64_t step = secondHash(hash);
+    const uint64_t mask = m_width - 1;
+    for (size_t row = 0; row < m_depth; ++row) {
+        out[row] = row * m_width + static_cast<size_t>((hash + row * step) & mask);
+    }
+}
+
+void CountMinSketch::addHash(uint64_t hash, uint32_t count)
+{
+    size_t index[MaxDepth];
+    indices(hash, index);
+
+    uint32_t minimum = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < m_depth; ++row) {
+        minimum = std::min(minimum, m_counters[index[row]]);
+    }
+
+    const uint32_t target = minimum > std::numeric_limits<uint32_t>::max() - count
+        ? std::numeric_limits<uint32_t>::max()
+        : minimum + count;
+
+    for (size_t row = 0; row < m_depth; ++row) {
+        uint32_t& counter = m_counters[index[row]];
+        counter = std::max(counter, target);
+    }
+}
+
+uint32_t CountMinSketch::estimateHash(uint64_t hash) const
+{
+    size_t index[MaxDepth];
+    indices(hash, index);
+
+    uint32_t minimum = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < m_depth; ++row) {
+        minimum = std::min(minimum, m_counters[index[row]]);
+    }
+    return minimum;
+}
+
+bool CountMinSketch::merge(const CountMinSketch& other)
+{
+    if (other.m_width != m_width || other.m_depth != m_depth || other.m_seed != m_seed) {
+        return false;
+    }
+
+    //
+    // INFO: Sum of conservative sketches is still an upper bound
+    //
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+        const uint32_t a = m_counters[i];
+        const uint32_t b = other.m_counters[i];
+        m_counters[i] = a > std::numeric_limits<uint32_t>::max() - b ? std::numeric_limits<uint32_t>::max() : a + b;
+    }
+    return true;
+}
+
+void CountMinSketch::clear()
+{
+    std::fill(m_counters.begin(), m_counters.end(), 0u);
+}
+
+void CountMinSketch::serialize(std::vector<uint8_t>& out) const
+{
+    SketchWriter writer(out);
+    writer.header(SketchKind::CountMin, m_seed);
+    writer.u32(static_cast<uint32_t>(m_width));
+    writer.u32(static_cast<uint32_t>(m_depth));
+    for (uint32_t counter : m_counters) {
+        writer.u32(counter);
+    }
+}
+
+bool CountMinSketch::deserialize(const uint8_t* data, size_t size)
+{
+    SketchReader reader(data, size);
+
+    uint64_t seed = 0;
+    uint32_t width = 0;
+    uint32_t depth = 0;
+    if (!reader.header(SketchKind::CountMin, seed) || !reader.u32(width) || !reader.u32(depth)) {
+        return false;
+    }
+
+    if (width == 0 || (width & (width - 1)) != 0 || depth == 0 || depth > MaxDepth
+        || reader.left() / 4 < static_cast<size_t>(width) * depth) {
+        return false;
+    }
+
+    std::vector<uint32_t> counters(static_cast<size_t>(width) * depth);
+    for (auto& counter : counters) {
+        reader.u32(counter);
+    }
+
+    m_width = width;
+    m_depth = depth;
+    m_seed = seed;
+    m_counters = std::move(counters);
+    return true;
+}
+
+//
+// BlockedBloomFilter
+//
+
+namespace {
+constexpr uint32_t BloomSalts[8] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+}
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedItems, double bitsPerItem, uint64_t seed)
+    : m_seed(seed)
+{
+    const double bits = std::max(1.0, static_cast<double>(expectedItems) * bitsPerItem);
+    const auto blocks = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / 256.0)));
+    m_words.assign(blocks * BlockWords, 0);
+}
+
+size_t BlockedBloomFilter::blockOf(uint64_t hash) const
+{
+    //
+    // INFO: Multiply-shift maps high half of hash onto block count without division
+    //
+    return static_cast<size_t>(((hash >> 32u) * static_cast<uint64_t>(blockCount())) >> 32u);
+}
+
+void BlockedBloomFilter::addHash(uint64_t hash)
+{
+    uint32_t* block = m_words.data() + blockOf(hash) * BlockWords;
+    const auto key = static_cast<uint32_t>(hash);
+    for (size_t i = 0; i < BlockWords; ++i) {
+        block[i] |= uint32_t(1) << ((key * BloomSalts[i]) >> 27u);
+    }
+}
+
+bool BlockedBloomFilter::containsHash(uint64_t hash) const
+{
+    const uint32_t* block = m_words.data() + blockOf(hash) * BlockWords;
+    const auto key = static_cast<uint32_t>(hash);
+
+    //
+    // INFO: No early exit, all eight words are checked as one vector
+    //
+    uint32_t missing = 0;
+    for (size_t i = 0; i < BlockWords; ++i) {
+        const uint32_t bit = uint32_t(1) << ((key * BloomSalts[i]) >> 27u);
+        missing |= ~block[i] & bit;
+    }
+    return missing == 0;
+}
+
+bool BlockedBloomFilter::merge(const BlockedBloomFilter& other)
+{
+    if (other.m_words.size() != m_words.size() || other.m_seed != m_seed) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_words.size(); ++i) {
+        m_words[i] |= other.m_words[i];
+    }
+    return true;
+}
+
+void BlockedBloomFilter::clear()
+{
+    std::fill(m_words.begin(), m_words.end(), 0u);
+}
+
+void BlockedBloomFilter::serialize(std::vector<uint8_t>& out) const
+{
+    SketchWriter writer(out);
+    writer.header(SketchKind::BlockedBloom, m_seed);
+    writer.u32(static_cast<uint32_t>(blockCount()));
+    for (uint32_t word : m_words) {
+        writer.u32(word);
+    }
+}
+
+bool BlockedBloomFilter::deserialize(const uint8_t* data, size_t size)
+{
+    SketchReader reader(data, size);
+
+    uint64_t seed = 0;
+    uint32_t blocks = 0;
+    if (!reader.header(SketchKind::BlockedBloom, seed) || !reader.u32(blocks)
+        || blocks == 0 || reader.left() / 4 < static_cast<size_t>(blocks) * BlockWords) {
+        return false;
+    }
+
+    std::vector<uint32_t> words(static_cast<size_t>(blocks) * BlockWords);
+    for (auto& word : words) {
+        reader.u32(word);
+    }
+
+    m_seed = seed;
+    m_words = std::move(words);
+    return true;
+}
+
+//
+// CuckooFilter
+//
+
+CuckooFilter::CuckooFilter(size_t capacity, uint64_t seed)
+    : m_seed(seed)
+{
+    //
+    // INFO: Four slots per bucket reach ~95% load before inserts start failing
+    //
+    const auto buckets = static_cast<size_t>(roundUpToPowerOfTwo(std::max<size_t>(1, (capacity * 100 / 95 + BucketSlots - 1) / BucketSlots)));
+    m_slots.assign(buckets * BucketSlots, 0);
+}
+
+size_t CuckooFilter::alternateBucket(size_t bucket, uint16_t fingerprint) const
+{
+    return (bucket ^ static_cast<size_t>(mixHash(fingerprint, 0))) & (bucketCount() - 1);
+}
+
+bool CuckooFilter::bucketContains(size_t bucket, uint16_t fingerprint) const
+{
+    const uint16_t* slots = m_slots.data() + bucket * BucketSlots;
+    bool found = false;
+    for (size_t i = 0; i < BucketSlots; ++i) {
+        found |= slots[i] == fingerprint;
+    }
+    return found;
+}
+
+bool CuckooFilter::insertFingerprint(size_t bucket, uint16_t fingerprint)
+{
+    uint16_t* slots = m_slots.data() + bucket * BucketSlots;
+    for (size_t i = 0; i < BucketSlots; ++i) {
+        if (slots[i] == 0) {
+            slots[i] = fingerprint;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t CuckooFilter::fingerprintOf(uint64_t hash)
+{
+    //
+    // INFO: Zero marks empty slot, so fingerprint is never zero
+    //
+    const auto fingerprint = static_cast<uint16_t>(hash >> 48u);
+    return fingerprint == 0 ? 1 : fingerprint;
+}
+
+void CuckooFilter::place(size_t bucket, uint16_t fingerprint)
+{
+    ally_assert(!m_hasVictim);
+
+    if (insertFingerprint(bucket, fingerprint) || insertFingerprint(alternateBucket(bucket, fingerprint), fingerprint)) {
+        return;
+    }
+
+    //
+    // INFO: Evicted slot is picked by fingerprint bits instead of random
+    // draw, so the same sequence of adds always gives the same filter
+    //
+    for (int kick = 0; kick < MaxKicks; ++kick) {
+        uint16_t& slot = m_slots[bucket * BucketSlots + (fingerprint + static_cast<unsigned>(kick)) % BucketSlots];
+        std::swap(slot, fingerprint);
+        bucket = alternateBucket(bucket, fingerprint);
+        if (insertFingerprint(bucket, fingerprint)) {
+            return;
+        }
+    }
+
+    //
+    // INFO: Keep last evicted fingerprint aside, filter must not lose items
+    //
+    m_hasVictim = true;
+    m_victimFingerprint = fingerprint;
+    m_victimBucket = bucket;
+}
+
+bool CuckooFilter::addHash(uint64_t hash)
+{
+    if (m_hasVictim) {
+        return false;
+    }
+
+    place(static_cast<size_t>(hash) & (bucketCount() - 1), fingerprintOf(hash));
+    ++m_size;
+    return true;
+}
+
+bool CuckooFilter::containsHash(uint64_t hash) const
+{
+    const uint16_t fingerprint = fingerprintOf(hash);
+    const size_t bucket = static_cast<size_t>(hash) & (bucketCount() - 1);
+    const size_t alternate = alternateBucket(bucket, fingerprint);
+
+    const bool victim = m_hasVictim && m_victimFingerprint == fingerprint
+        && (m_victimBucket == bucket || m_victimBucket == alternate);
+    return victim || bucketContains(bucket, fingerprint) || bucketContains(alternate, fingerprint);
+}
+
+bool CuckooFilter::eraseHash(uint64_t hash)
+{
+    const uint16_t fingerprint = fingerprintOf(hash);
+    const size_t bucket = static_cast<size_t>(hash) & (bucketCount() - 1);
+    const size_t alternate = alternateBucket(bucket, fingerprint);
+
+    if (m_hasVictim && m_victimFingerprint == fingerprint && (m_victimBucket == bucket || m_victimBucket == alternate)) {
+        m_hasVictim = false;
+        --m_size;
+        return true;
+    }
+
+    for (size_t candidate : { bucket, alternate }) {
+        uint16_t* slots = m_slots.data() + candidate * BucketSlots;
+        for (size_t i = 0; i < BucketSlots; ++i) {
+            if (slots[i] != fingerprint) {
+                continue;
+            }
+
+            slots[i] = 0;
+            --m_size;
+
+            if (m_hasVictim) {
+                m_hasVictim = false;
+                place(m_victimBucket, m_victimFingerprint);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::merge(const CuckooFilter& other)
+{
+    if (other.m_slots.size() != m_slots.size() || other.m_seed != m_seed) {
+        return false;
+    }
+
+    //
+    // INFO: Fingerprints are re-placed from their bucket, returns false
+    // when filter gets full, items merged so far stay in filter
+    //
+    for (size_t index = 0; index < other.m_slots.size(); ++index) {
+        const uint16_t fingerprint = other.m_slots[index];
+        if (fingerprint == 0) {
+            continue;
+        }
+        if (m_hasVictim) {
+            return false;
+        }
+        place(index / BucketSlots, fingerprint);
+        ++m_size;
+    }
+
+    if (other.m_hasVictim) {
+        if (m_hasVictim) {
+            return false;
+        }
+        place(other.m_victimBucket, other.m_victimFingerprint);
+        ++m_size;
+    }
+    return true;
+}
+
+void CuckooFilter::clear()
+{
+    std::fill(m_slots.begin(), m_slots.end(), uint16_t(0));
+    m_size = 0;
+    m_hasVictim = false;
+}
+
+void CuckooFilter::serialize(std::vector<uint8_t>& out) const
+{
+    SketchWriter writer(out);
+    writer.header(SketchKind::Cuckoo, m_seed);
+    writer.u32(static_cast<uint32_t>(bucketCount()));
+    writer.u64(m_size);
+    writer.u8(m_hasVictim ? 1 : 0);
+    writer.u16(m_victimFingerprint);
+    writer.u32(static_cast<uint32_t>(m_victimBucket));
+    for (uint16_t fingerprint : m_slots) {
+        writer.u16(fingerprint);
+    }
+}
+
+bool CuckooFilter::deserialize(const uint8_t* data, size_t size)
+{
+    SketchReader reader(data, size);
+
+    uint64_t seed = 0;
+    uint32_t buckets = 0;
+    uint64_t count = 0;
+    uint8_t hasVictim = 0;
+    uint16_t victimFingerprint = 0;
+    uint32_t victimBucket = 0;
+    if (!reader.header(SketchKind::Cuckoo, seed) || !reader.u32(buckets) || !reader.u64(count)
+        || !reader.u8(hasVictim) || !reader.u16(victimFingerprint) || !reader.u32(victimBucket)) {
+        return false;
+    }
+
+    if (buckets == 0 || (buckets & (buckets - 1)) != 0 || victimBucket >= buckets
+        || reader.left() / 2 < static_cast<size_t>(buckets) * BucketSlots) {
+        return false;
+    }
+
+    std::vector<uint16_t> slots(static_cast<size_t>(buckets) * BucketSlots);
+    for (auto& fingerprint : slots) {
+        reader.u16(fingerprint);
+    }
+
+    m_seed = seed;
+    m_slots = std::move(slots);
+    m_size = static_cast<size_t>(count);
+    m_hasVictim = hasVictim != 0;
+    m_victimFingerprint = victimFingerprint;
+    m_victimBucket = victimBucket;
+    return true;
+}
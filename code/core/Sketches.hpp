@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Hash.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//
+// INFO: Probabilistic sketches for analytics: distinct counts (HyperLogLog),
+// frequencies (CountMinSketch) and membership (BlockedBloomFilter, CuckooFilter).
+//
+// Items are hashed with 'hashValue(item, seed)'. Default seed of every sketch is
+// derived from server seed (see 'ServerRandomTraits::setSeed'), so sketches built
+// on different nodes are reproducible and can be merged. Merge and 'deserialize'
+// return false when sketch parameters or seeds don't match.
+//
+// Serialized form is little-endian: 'magic, kind, version, seed' header followed
+// by sketch payload, see Sketches.cpp
+//
+uint64_t sketchSeed(std::string_view family);
+
+//
+// INFO: Precision is clamped to [MinPrecision, MaxPrecision], the range
+// 'deserialize' accepts
+//
+class HyperLogLog {
+public:
+    static constexpr int MinPrecision = 4;
+    static constexpr int MaxPrecision = 18;
+
+    explicit HyperLogLog(int precision = 14, uint64_t seed = sketchSeed("HyperLogLog"));
+
+    template <typename T>
+    void add(const T& item) { addHash(hashValue(item, m_seed)); }
+
+    void addHash(uint64_t hash);
+    void addHashes(const uint64_t* hashes, size_t count);
+
+    double estimate() const;
+
+    bool merge(const HyperLogLog& other);
+    void clear();
+
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+
+    int precision() const { return m_precision; }
+    uint64_t seed() const { return m_seed; }
+
+private:
+    int m_precision;
+    uint64_t m_seed;
+    std::vector<uint8_t> m_registers;
+};
+
+//
+// INFO: Conservative update, counter is raised only up to new minimum,
+// it never underestimates and overestimates less than plain Count-Min.
+// Depth is clamped to [1, MaxDepth]
+//
+class CountMinSketch {
+public:
+    explicit CountMinSketch(size_t width = 2048, size_t depth = 4, uint64_t seed = sketchSeed("CountMinSketch"));
+
+    template <typename T>
+    void add(const T& item, uint32_t count = 1) { addHash(hashValue(item, m_seed), count); }
+
+    template <typename T>
+    uint32_t estimate(const T& item) const { return estimateHash(hashValue(item, m_seed)); }
+
+    void addHash(uint64_t hash, uint32_t count = 1);
+    uint32_t estimateHash(uint64_t hash) const;
+
+    bool merge(const CountMinSketch& other);
+    void clear();
+
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+
+    size_t width() const { return m_width; }
+    size_t depth() const { return m_depth; }
+    uint64_t seed() const { return m_seed; }
+
+private:
+    static constexpr size_t MaxDepth = 16;
+
+    void indices(uint64_t hash, size_t* out) const;
+
+private:
+    size_t m_width;
+    size_t m_depth;
+    uint64_t m_seed;
+    std::vector<uint32_t> m_counters;
+};
+
+//
+// INFO: Split block Bloom filter, every item sets one bit in each of eight
+// 32-bit words of one 256-bit block, so add and query touch one cache line
+// and the eight words are processed as one vector
+//
+class BlockedBloomFilter {
+public:
+    explicit BlockedBloomFilter(size_t expectedItems = 1024, double bitsPerItem = 10.0, uint64_t seed = sketchSeed("BlockedBloomFilter"));
+
+    template <typename T>
+    void add(const T& item) { addHash(hashValue(item, m_seed)); }
+
+    template <typename T>
+    bool contains(const T& item) const { return containsHash(hashValue(item, m_seed)); }
+
+    void addHash(uint64_t hash);
+    bool containsHash(uint64_t hash) const;
+
+    bool merge(const BlockedBloomFilter& other);
+    void clear();
+
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+
+    size_t blockCount() const { return m_words.size() / BlockWords; }
+    uint64_t seed() const { return m_seed; }
+
+private:
+    static constexpr size_t BlockWords = 8;
+
+    size_t blockOf(uint64_t hash) const;
+
+private:
+    uint64_t m_seed;
+    std::vector<uint32_t> m_words;
+};
+
+//
+// INFO: Cuckoo filter with 16-bit fingerprints and four slots per bucket,
+// unlike Bloom filter it supports 'erase'. 'add' fails when filter is full.
+// Erase only items that were added, otherwise other item can be lost
+//
+class CuckooFilter {
+public:
+    explicit CuckooFilter(size_t capacity = 1024, uint64_t seed = sketchSeed("CuckooFilter"));
+
+    template <typename T>
+    bool add(const T& item) { return addHash(hashValue(item, m_seed)); }
+
+    template <typename T>
+    bool contains(const T& item) const { return containsHash(hashValue(item, m_seed)); }
+
+    template <typename T>
+    bool erase(const T& item) { return eraseHash(hashValue(item, m_seed)); }
+
+    bool addHash(uint64_t hash);
+    bool containsHash(uint64_t hash) const;
+    bool eraseHash(uint64_t hash);
+
+    bool merge(const CuckooFilter& other);
+    void clear();
+
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+
+    size_t size() const { return m_size; }
+    size_t bucketCount() const { return m_slots.size() / BucketSlots; }
+    uint64_t seed() const { return m_seed; }
+
+private:
+    static constexpr size_t BucketSlots = 4;
+    static constexpr int MaxKicks = 500;
+
+    static uint16_t fingerprintOf(uint64_t hash);
+
+    size_t alternateBucket(size_t bucket, uint16_t fingerprint) const;
+    void place(size_t bucket, uint16_t fingerprint);
+    bool insertFingerprint(size_t bucket, uint16_t fingerprint);
+    bool bucketContains(size_t bucket, uint16_t fingerprint) const;
+
+private:
+    uint64_t m_seed;
+    std::vector<uint16_t> m_slots;
+    size_t m_size = 0;
+    bool m_hasVictim = false;
+    uint16_t m_victimFingerprint = 0;
+    size_t m_victimBucket = 0;
+};
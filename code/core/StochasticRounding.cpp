@@ -0,0 +1,155 @@
+#include "StochasticRounding.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int FractionBits = 24;
+constexpr float FractionScale = static_cast<float>(1u << FractionBits);
+constexpr int32_t HalfFraction = int32_t(1) << (FractionBits - 1);
+
+enum class Rounding {
+    Stochastic,
+    Dithered
+};
+
+//
+// INFO: Noise in 2^-24 units added to fractional part before truncation,
+// stochastic noise is uniform in [0, 1), dithered is 1/2 + triangular in (-1, 1)
+//
+template <Rounding Mode>
+void noiseBlock(Xoshiro128x8& generator, int32_t* noise)
+{
+    uint32_t first[Xoshiro128x8::Lanes];
+    generator.next(first);
+
+    if constexpr (Mode == Rounding::Stochastic) {
+        for (size_t lane = 0; lane < Xoshiro128x8::Lanes; ++lane) {
+            noise[lane] = static_cast<int32_t>(first[lane] >> (32 - FractionBits));
+        }
+    } else {
+        uint32_t second[Xoshiro128x8::Lanes];
+        generator.next(second);
+        for (size_t lane = 0; lane < Xoshiro128x8::Lanes; ++lane) {
+            noise[lane] = HalfFraction + static_cast<int32_t>(first[lane] >> (32 - FractionBits)) - static_cast<int32_t>(second[lane] >> (32 - FractionBits));
+        }
+    }
+}
+
+template <typename Out>
+Out quantizeOne(float value, float inverseScale, int32_t noise)
+{
+    constexpr auto low = static_cast<float>(std::numeric_limits<Out>::min());
+    constexpr auto high = static_cast<float>(std::numeric_limits<Out>::max());
+
+    const float scaled = std::min(std::max(value * inverseScale, low), high);
+    const float whole = std::floor(scaled);
+    const auto fraction = static_cast<int32_t>((scaled - whole) * FractionScale);
+
+    const int32_t rounded = static_cast<int32_t>(whole) + ((fraction + noise) >> FractionBits);
+    return static_cast<Out>(std::min<int32_t>(std::max<int32_t>(rounded, std::numeric_limits<Out>::min()), std::numeric_limits<Out>::max()));
+}
+
+#if defined(__AVX2__)
+template <Rounding Mode>
+__m256i noiseVector(Xoshiro128x8& generator)
+{
+    const __m256i first = _mm256_srli_epi32(generator.nextVector(), 32 - FractionBits);
+    if constexpr (Mode == Rounding::Stochastic) {
+        return first;
+    } else {
+        const __m256i second = _mm256_srli_epi32(generator.nextVector(), 32 - FractionBits);
+        return _mm256_sub_epi32(_mm256_add_epi32(_mm256_set1_epi32(HalfFraction), first), second);
+    }
+}
+
+void storeNarrow(int16_t* out, __m256i values)
+{
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(values, values), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+}
+
+void storeNarrow(int8_t* out, __m256i values)
+{
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(values, values), 0x08);
+    const __m128i narrow = _mm256_castsi256_si128(packed);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi16(narrow, narrow));
+}
+#endif
+
+template <Rounding Mode, typename Out>
+void quantize(const float* in, Out* out, size_t count, float scale, Xoshiro128x8& generator)
+{
+    constexpr size_t Lanes = Xoshiro128x8::Lanes;
+
+    const float inverseScale = 1.f / scale;
+    int32_t noise[Lanes];
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256 low = _mm256_set1_ps(static_cast<float>(std::numeric_limits<Out>::min()));
+    const __m256 high = _mm256_set1_ps(static_cast<float>(std::numeric_limits<Out>::max()));
+    const __m256 inverse = _mm256_set1_ps(inverseScale);
+    const __m256 fractionScale = _mm256_set1_ps(FractionScale);
+
+    for (; i + Lanes <= count; i += Lanes) {
+        const __m256i noiseLanes = noiseVector<Mode>(generator);
+
+        const __m256 value = _mm256_loadu_ps(in + i);
+        const __m256 scaled = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(value, inverse), low), high);
+        const __m256 whole = _mm256_floor_ps(scaled);
+        const __m256i fraction = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(scaled, whole), fractionScale));
+
+        const __m256i carry = _mm256_srai_epi32(_mm256_add_epi32(fraction, noiseLanes), FractionBits);
+        storeNarrow(out + i, _mm256_add_epi32(_mm256_cvttps_epi32(whole), carry));
+    }
+#endif
+
+    for (; i < count; i += Lanes) {
+        noiseBlock<Mode>(generator, noise);
+
+        const size_t block = std::min(Lanes, count - i);
+        for (size_t lane = 0; lane < block; ++lane) {
+            out[i + lane] = quantizeOne<Out>(in[i + lane], inverseScale, noise[lane]);
+        }
+    }
+}
+
+template <typename In>
+void dequantizeAll(const In* in, float* out, size_t count, float scale)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(in[i]) * scale;
+    }
+}
+}
+
+void quantizeStochastic(const float* in, int8_t* out, size_t count, float scale, Xoshiro128x8& generator)
+{
+    quantize<Rounding::Stochastic>(in, out, count, scale, generator);
+}
+
+void quantizeStochastic(const float* in, int16_t* out, size_t count, float scale, Xoshiro128x8& generator)
+{
+    quantize<Rounding::Stochastic>(in, out, count, scale, generator);
+}
+
+void quantizeDithered(const float* in, int8_t* out, size_t count, float scale, Xoshiro128x8& generator)
+{
+    quantize<Rounding::Dithered>(in, out, count, scale, generator);
+}
+
+void quantizeDithered(const float* in, int16_t* out, size_t count, float scale, Xoshiro128x8& generator)
+{
+    quantize<Rounding::Dithered>(in, out, count, scale, generator);
+}
+
+void dequantize(const int8_t* in, float* out, size_t count, float scale)
+{
+    dequantizeAll(in, out, count, scale);
+}
+
+void dequantize(const int16_t* in, float* out, size_t count, float scale)
+{
+    dequantizeAll(in, out, count, scale);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "SimdRandom.hpp"
+#include <cstddef>
+#include <cstdint>
+
+//
+// INFO: Quantization of float buffers to int8/int16 with random rounding,
+// value 'x' becomes 'round(x / scale)', rounding direction is random:
+//
+// 'quantizeStochastic' - up with probability of fractional part, so
+//     quantized value is unbiased, E[q * scale] = x
+// 'quantizeDithered' - to nearest after adding triangular noise in (-1, 1),
+//     quantization error doesn't depend on signal
+//
+// Values are clamped to the range of output type, NaN is not supported.
+// Kernels use AVX2 when it is enabled at compile time, scalar fallback gives
+// identical output for the same generator state: noise is added in integer
+// arithmetic, so results don't depend on FMA contraction or instruction set
+//
+// Usage:
+//   Xoshiro128x8 generator(seed);
+//   quantizeStochastic(gradients.data(), packed.data(), gradients.size(), step, generator);
+//   dequantize(packed.data(), restored.data(), packed.size(), step);
+//
+void quantizeStochastic(const float* in, int8_t* out, size_t count, float scale, Xoshiro128x8& generator);
+void quantizeStochastic(const float* in, int16_t* out, size_t count, float scale, Xoshiro128x8& generator);
+
+void quantizeDithered(const float* in, int8_t* out, size_t count, float scale, Xoshiro128x8& generator);
+void quantizeDithered(const float* in, int16_t* out, size_t count, float scale, Xoshiro128x8& generator);
+
+void dequantize(const int8_t* in, float* out, size_t count, float scale);
+void dequantize(const int16_t* in, float* out, size_t count, float scale);
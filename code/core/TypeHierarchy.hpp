@@ -0,0 +1,214 @@
+#pragma once
+
+#include "TypeIndex.hpp"
+#include "Assertions.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename Root>
+class TypeHierarchy;
+
+template <typename Root, typename T>
+TypeIndex hierarchyIndexOf()
+{
+    return orderedTypeIndex<TypeHierarchy<Root>, T>();
+}
+
+//
+// INFO: Single inheritance tree of types under 'Root' numbered in preorder,
+// every type owns interval '[enter, exit)' that contains numbers of all its
+// descendants, so 'isA' is two integer compares, no 'dynamic_cast' or RTTI.
+// Types register their parent once at startup, intervals are rebuilt on
+// every registration, registration isn't thread safe. Type that isn't
+// registered is a tree root and 'isA' only itself
+//
+// Usage:
+//   TypeHierarchy<Shape>::instance().add<Circle, Shape>();
+//   TypeHierarchy<Shape>::instance().add<Ring, Circle>();
+//
+template <typename Root>
+class TypeHierarchy {
+public:
+    static TypeHierarchy& instance()
+    {
+        static TypeHierarchy s_instance;
+        return s_instance;
+    }
+
+    //
+    // INFO: Returns false when 'T' already has another parent,
+    // multiple inheritance can't be described by intervals
+    //
+    template <typename T, typename Parent>
+    bool add()
+    {
+        static_assert(std::is_base_of<Parent, T>::value && !std::is_same<Parent, T>::value, "Parent must be base of type.");
+        return add(hierarchyIndexOf<Root, T>(), hierarchyIndexOf<Root, Parent>());
+    }
+
+    bool add(TypeIndex type, TypeIndex parent)
+    {
+        reserve(std::max(type, parent) + 1);
+        if (m_parents[type] != NoParent) {
+            return m_parents[type] == parent;
+        }
+
+        ally_assert(!isA(parent, type), "type can't be parent of its ancestor");
+        m_parents[type] = parent;
+        rebuild();
+        return true;
+    }
+
+    bool isA(TypeIndex type, TypeIndex base) const
+    {
+        if (type >= m_intervals.size() || base >= m_intervals.size()) {
+            return type == base;
+        }
+
+        const uint32_t number = m_intervals[type].enter;
+        const Interval interval = m_intervals[base];
+        return interval.enter <= number && number < interval.exit;
+    }
+
+    template <typename Base>
+    bool isA(TypeIndex type) const
+    {
+        return isA(type, hierarchyIndexOf<Root, Base>());
+    }
+
+    TypeIndex parentOf(TypeIndex type) const
+    {
+        return type < m_parents.size() ? m_parents[type] : NoParent;
+    }
+
+    static constexpr TypeIndex NoParent = ~TypeIndex(0);
+
+private:
+    struct Interval {
+        uint32_t enter = 0;
+        uint32_t exit = 0;
+    };
+
+    void reserve(size_t size)
+    {
+        if (size > m_parents.size()) {
+            m_parents.resize(size, NoParent);
+            rebuild();
+        }
+    }
+
+    //
+    // INFO: Iterative DFS over forest, children are visited in index order
+    //
+    void rebuild()
+    {
+        const size_t size = m_parents.size();
+
+        std::vector<uint32_t> childStarts(size + 1, 0);
+        for (TypeIndex parent : m_parents) {
+            if (parent != NoParent) {
+                ++childStarts[parent + 1];
+            }
+        }
+        for (size_t i = 1; i <= size; ++i) {
+            childStarts[i] += childStarts[i - 1];
+        }
+
+        std::vector<TypeIndex> children(childStarts[size]);
+        std::vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+        for (TypeIndex type = 0; type < size; ++type) {
+            if (m_parents[type] != NoParent) {
+                children[cursors[m_parents[type]]++] = type;
+            }
+        }
+
+        m_intervals.assign(size, Interval());
+        uint32_t number = 0;
+        std::vector<std::pair<TypeIndex, uint32_t>> stack;
+        for (TypeIndex root = 0; root < size; ++root) {
+            if (m_parents[root] != NoParent) {
+                continue;
+            }
+
+            m_intervals[root].enter = number++;
+            stack.emplace_back(root, childStarts[root]);
+            while (!stack.empty()) {
+                auto& top = stack.back();
+                if (top.second == childStarts[top.first + 1]) {
+                    m_intervals[top.first].exit = number;
+                    stack.pop_back();
+                    continue;
+                }
+
+                const TypeIndex child = children[top.second++];
+                m_intervals[child].enter = number++;
+                stack.emplace_back(child, childStarts[child]);
+            }
+        }
+    }
+
+private:
+    std::vector<TypeIndex> m_parents;
+    std::vector<Interval> m_intervals;
+};
+
+//
+// INFO: Base of hierarchy checked by 'is' and 'as', object stores index
+// of its dynamic type. Derived classes inherit through 'HierarchyType',
+// it stores their index, so it can't be forgotten
+//
+// Usage:
+//   class Shape : public HierarchyTarget<Shape> { ... };
+//   class Circle : public HierarchyType<Circle, Shape> { ... };
+//
+//   if (auto* circle = as<Circle>(shape)) { ... }
+//
+template <typename Root>
+class HierarchyTarget : public TypeIndexed<TypeHierarchy<Root>> {
+public:
+    using HierarchyRoot = Root;
+
+    TypeIndex hierarchyIndex() const { return this->typeIndex(); }
+
+protected:
+    HierarchyTarget()
+        : TypeIndexed<TypeHierarchy<Root>>(hierarchyIndexOf<Root, Root>())
+    {
+    }
+};
+
+//
+// INFO: 'IndexedType' with context of hierarchy named, so class that is also
+// 'DispatchTarget' still gets unambiguous base. Its constructor is 'IndexedType'
+//
+// Usage:
+//   class Ship : public HierarchyType<Ship, Entity> {
+//   public:
+//       Ship() : IndexedType(dispatchIndexOf<Entity, Ship>()) {}
+//   };
+//
+template <typename Derived, typename Base>
+using HierarchyType = IndexedType<Derived, Base, TypeHierarchy<typename Base::HierarchyRoot>>;
+
+template <typename T, typename U>
+bool is(const U& object)
+{
+    using Root = typename U::HierarchyRoot;
+    static_assert(std::is_base_of<Root, T>::value, "Type must belong to object hierarchy.");
+    return TypeHierarchy<Root>::instance().template isA<T>(object.hierarchyIndex());
+}
+
+template <typename T, typename U>
+T* as(U* object)
+{
+    return object && is<T>(*object) ? static_cast<T*>(object) : nullptr;
+}
+
+template <typename T, typename U>
+const T* as(const U* object)
+{
+    return object && is<T>(*object) ? static_cast<const T*>(object) : nullptr;
+}
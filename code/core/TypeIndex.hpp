@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <utility>
 
 using TypeIndex = size_t;
 
@@ -11,14 +13,18 @@ TypeIndex unorderedTypeIndex()
     return reinterpret_cast<TypeIndex>(&takeMyAddress);
 }
 
+//
+// INFO: Counter is shared by all types of context, first lookups of two types
+// may race from different threads, so increment is atomic
+//
 template <typename UniqueUsageContext>
 struct InstantiationCounter {
-    static TypeIndex lastInstantiatedCounterForContext;
-    const TypeIndex savedAtTimeCounterForContext = lastInstantiatedCounterForContext++;
+    static std::atomic<TypeIndex> lastInstantiatedCounterForContext;
+    const TypeIndex savedAtTimeCounterForContext = lastInstantiatedCounterForContext.fetch_add(1, std::memory_order_relaxed);
 };
 
 template <typename UniqueUsageContext>
-TypeIndex InstantiationCounter<UniqueUsageContext>::lastInstantiatedCounterForContext = 0;
+std::atomic<TypeIndex> InstantiationCounter<UniqueUsageContext>::lastInstantiatedCounterForContext { 0 };
 
 template <typename UniqueUsageContext, typename T>
 TypeIndex orderedTypeIndex()
@@ -26,3 +32,54 @@ TypeIndex orderedTypeIndex()
     static InstantiationCounter<UniqueUsageContext> instance;
     return instance.savedAtTimeCounterForContext;
 }
+
+//
+// INFO: Object that stores 'orderedTypeIndex<Context, T>' of its dynamic type 'T',
+// storage shared by 'DispatchTarget' and 'HierarchyTarget'. Bases of different
+// contexts are different types, so one class can derive from both
+//
+template <typename Context>
+class TypeIndexed {
+public:
+    using TypeIndexContext = Context;
+
+protected:
+    explicit TypeIndexed(TypeIndex index)
+        : m_typeIndex(index)
+    {
+    }
+
+    TypeIndex typeIndex() const { return m_typeIndex; }
+
+private:
+    template <typename Derived, typename Base, typename IndexContext>
+    friend class IndexedType;
+
+    void setTypeIndex(TypeIndex index) { m_typeIndex = index; }
+
+private:
+    TypeIndex m_typeIndex;
+};
+
+//
+// INFO: CRTP step between 'Base' and 'Derived', constructor arguments go to 'Base',
+// then index of 'Derived' in 'Context' is stored. Constructors run from base to
+// most derived, so object ends up with index of its most derived 'IndexedType'.
+// Class with two indexed bases names 'Context', see 'HierarchyType'
+//
+// Usage:
+//   class Circle : public IndexedType<Circle, Shape> {
+//   public:
+//       explicit Circle(float radius) : IndexedType(ShapeKind::Round), m_radius(radius) {}
+//   };
+//
+template <typename Derived, typename Base, typename Context = typename Base::TypeIndexContext>
+class IndexedType : public Base {
+protected:
+    template <typename... Args>
+    explicit IndexedType(Args&&... args)
+        : Base(std::forward<Args>(args)...)
+    {
+        static_cast<TypeIndexed<Context>*>(this)->setTypeIndex(orderedTypeIndex<Context, Derived>());
+    }
+};